@@ -0,0 +1,215 @@
+/*
+ * Compile-time benchmark: a translation unit declaring and reading 100 options.
+ * (See compile_time.sh)
+ */
+
+#include "../incfg.hpp"
+
+
+INCFG_REQUIRE( int, BENCH_OPT_000, -0, "Benchmark option 0" )
+INCFG_REQUIRE( unsigned int, BENCH_OPT_001, 1u, "Benchmark option 1" )
+INCFG_REQUIRE( double, BENCH_OPT_002, 2.5, "Benchmark option 2" )
+INCFG_REQUIRE( bool, BENCH_OPT_003, true, "Benchmark option 3" )
+INCFG_REQUIRE( std::string, BENCH_OPT_004, "value_4", "Benchmark option 4" )
+INCFG_REQUIRE( int, BENCH_OPT_005, -5, "Benchmark option 5" )
+INCFG_REQUIRE( unsigned int, BENCH_OPT_006, 6u, "Benchmark option 6" )
+INCFG_REQUIRE( double, BENCH_OPT_007, 7.5, "Benchmark option 7" )
+INCFG_REQUIRE( bool, BENCH_OPT_008, false, "Benchmark option 8" )
+INCFG_REQUIRE( std::string, BENCH_OPT_009, "value_9", "Benchmark option 9" )
+INCFG_REQUIRE( int, BENCH_OPT_010, -10, "Benchmark option 10" )
+INCFG_REQUIRE( unsigned int, BENCH_OPT_011, 11u, "Benchmark option 11" )
+INCFG_REQUIRE( double, BENCH_OPT_012, 12.5, "Benchmark option 12" )
+INCFG_REQUIRE( bool, BENCH_OPT_013, true, "Benchmark option 13" )
+INCFG_REQUIRE( std::string, BENCH_OPT_014, "value_14", "Benchmark option 14" )
+INCFG_REQUIRE( int, BENCH_OPT_015, -15, "Benchmark option 15" )
+INCFG_REQUIRE( unsigned int, BENCH_OPT_016, 16u, "Benchmark option 16" )
+INCFG_REQUIRE( double, BENCH_OPT_017, 17.5, "Benchmark option 17" )
+INCFG_REQUIRE( bool, BENCH_OPT_018, false, "Benchmark option 18" )
+INCFG_REQUIRE( std::string, BENCH_OPT_019, "value_19", "Benchmark option 19" )
+INCFG_REQUIRE( int, BENCH_OPT_020, -20, "Benchmark option 20" )
+INCFG_REQUIRE( unsigned int, BENCH_OPT_021, 21u, "Benchmark option 21" )
+INCFG_REQUIRE( double, BENCH_OPT_022, 22.5, "Benchmark option 22" )
+INCFG_REQUIRE( bool, BENCH_OPT_023, true, "Benchmark option 23" )
+INCFG_REQUIRE( std::string, BENCH_OPT_024, "value_24", "Benchmark option 24" )
+INCFG_REQUIRE( int, BENCH_OPT_025, -25, "Benchmark option 25" )
+INCFG_REQUIRE( unsigned int, BENCH_OPT_026, 26u, "Benchmark option 26" )
+INCFG_REQUIRE( double, BENCH_OPT_027, 27.5, "Benchmark option 27" )
+INCFG_REQUIRE( bool, BENCH_OPT_028, false, "Benchmark option 28" )
+INCFG_REQUIRE( std::string, BENCH_OPT_029, "value_29", "Benchmark option 29" )
+INCFG_REQUIRE( int, BENCH_OPT_030, -30, "Benchmark option 30" )
+INCFG_REQUIRE( unsigned int, BENCH_OPT_031, 31u, "Benchmark option 31" )
+INCFG_REQUIRE( double, BENCH_OPT_032, 32.5, "Benchmark option 32" )
+INCFG_REQUIRE( bool, BENCH_OPT_033, true, "Benchmark option 33" )
+INCFG_REQUIRE( std::string, BENCH_OPT_034, "value_34", "Benchmark option 34" )
+INCFG_REQUIRE( int, BENCH_OPT_035, -35, "Benchmark option 35" )
+INCFG_REQUIRE( unsigned int, BENCH_OPT_036, 36u, "Benchmark option 36" )
+INCFG_REQUIRE( double, BENCH_OPT_037, 37.5, "Benchmark option 37" )
+INCFG_REQUIRE( bool, BENCH_OPT_038, false, "Benchmark option 38" )
+INCFG_REQUIRE( std::string, BENCH_OPT_039, "value_39", "Benchmark option 39" )
+INCFG_REQUIRE( int, BENCH_OPT_040, -40, "Benchmark option 40" )
+INCFG_REQUIRE( unsigned int, BENCH_OPT_041, 41u, "Benchmark option 41" )
+INCFG_REQUIRE( double, BENCH_OPT_042, 42.5, "Benchmark option 42" )
+INCFG_REQUIRE( bool, BENCH_OPT_043, true, "Benchmark option 43" )
+INCFG_REQUIRE( std::string, BENCH_OPT_044, "value_44", "Benchmark option 44" )
+INCFG_REQUIRE( int, BENCH_OPT_045, -45, "Benchmark option 45" )
+INCFG_REQUIRE( unsigned int, BENCH_OPT_046, 46u, "Benchmark option 46" )
+INCFG_REQUIRE( double, BENCH_OPT_047, 47.5, "Benchmark option 47" )
+INCFG_REQUIRE( bool, BENCH_OPT_048, false, "Benchmark option 48" )
+INCFG_REQUIRE( std::string, BENCH_OPT_049, "value_49", "Benchmark option 49" )
+INCFG_REQUIRE( int, BENCH_OPT_050, -50, "Benchmark option 50" )
+INCFG_REQUIRE( unsigned int, BENCH_OPT_051, 51u, "Benchmark option 51" )
+INCFG_REQUIRE( double, BENCH_OPT_052, 52.5, "Benchmark option 52" )
+INCFG_REQUIRE( bool, BENCH_OPT_053, true, "Benchmark option 53" )
+INCFG_REQUIRE( std::string, BENCH_OPT_054, "value_54", "Benchmark option 54" )
+INCFG_REQUIRE( int, BENCH_OPT_055, -55, "Benchmark option 55" )
+INCFG_REQUIRE( unsigned int, BENCH_OPT_056, 56u, "Benchmark option 56" )
+INCFG_REQUIRE( double, BENCH_OPT_057, 57.5, "Benchmark option 57" )
+INCFG_REQUIRE( bool, BENCH_OPT_058, false, "Benchmark option 58" )
+INCFG_REQUIRE( std::string, BENCH_OPT_059, "value_59", "Benchmark option 59" )
+INCFG_REQUIRE( int, BENCH_OPT_060, -60, "Benchmark option 60" )
+INCFG_REQUIRE( unsigned int, BENCH_OPT_061, 61u, "Benchmark option 61" )
+INCFG_REQUIRE( double, BENCH_OPT_062, 62.5, "Benchmark option 62" )
+INCFG_REQUIRE( bool, BENCH_OPT_063, true, "Benchmark option 63" )
+INCFG_REQUIRE( std::string, BENCH_OPT_064, "value_64", "Benchmark option 64" )
+INCFG_REQUIRE( int, BENCH_OPT_065, -65, "Benchmark option 65" )
+INCFG_REQUIRE( unsigned int, BENCH_OPT_066, 66u, "Benchmark option 66" )
+INCFG_REQUIRE( double, BENCH_OPT_067, 67.5, "Benchmark option 67" )
+INCFG_REQUIRE( bool, BENCH_OPT_068, false, "Benchmark option 68" )
+INCFG_REQUIRE( std::string, BENCH_OPT_069, "value_69", "Benchmark option 69" )
+INCFG_REQUIRE( int, BENCH_OPT_070, -70, "Benchmark option 70" )
+INCFG_REQUIRE( unsigned int, BENCH_OPT_071, 71u, "Benchmark option 71" )
+INCFG_REQUIRE( double, BENCH_OPT_072, 72.5, "Benchmark option 72" )
+INCFG_REQUIRE( bool, BENCH_OPT_073, true, "Benchmark option 73" )
+INCFG_REQUIRE( std::string, BENCH_OPT_074, "value_74", "Benchmark option 74" )
+INCFG_REQUIRE( int, BENCH_OPT_075, -75, "Benchmark option 75" )
+INCFG_REQUIRE( unsigned int, BENCH_OPT_076, 76u, "Benchmark option 76" )
+INCFG_REQUIRE( double, BENCH_OPT_077, 77.5, "Benchmark option 77" )
+INCFG_REQUIRE( bool, BENCH_OPT_078, false, "Benchmark option 78" )
+INCFG_REQUIRE( std::string, BENCH_OPT_079, "value_79", "Benchmark option 79" )
+INCFG_REQUIRE( int, BENCH_OPT_080, -80, "Benchmark option 80" )
+INCFG_REQUIRE( unsigned int, BENCH_OPT_081, 81u, "Benchmark option 81" )
+INCFG_REQUIRE( double, BENCH_OPT_082, 82.5, "Benchmark option 82" )
+INCFG_REQUIRE( bool, BENCH_OPT_083, true, "Benchmark option 83" )
+INCFG_REQUIRE( std::string, BENCH_OPT_084, "value_84", "Benchmark option 84" )
+INCFG_REQUIRE( int, BENCH_OPT_085, -85, "Benchmark option 85" )
+INCFG_REQUIRE( unsigned int, BENCH_OPT_086, 86u, "Benchmark option 86" )
+INCFG_REQUIRE( double, BENCH_OPT_087, 87.5, "Benchmark option 87" )
+INCFG_REQUIRE( bool, BENCH_OPT_088, false, "Benchmark option 88" )
+INCFG_REQUIRE( std::string, BENCH_OPT_089, "value_89", "Benchmark option 89" )
+INCFG_REQUIRE( int, BENCH_OPT_090, -90, "Benchmark option 90" )
+INCFG_REQUIRE( unsigned int, BENCH_OPT_091, 91u, "Benchmark option 91" )
+INCFG_REQUIRE( double, BENCH_OPT_092, 92.5, "Benchmark option 92" )
+INCFG_REQUIRE( bool, BENCH_OPT_093, true, "Benchmark option 93" )
+INCFG_REQUIRE( std::string, BENCH_OPT_094, "value_94", "Benchmark option 94" )
+INCFG_REQUIRE( int, BENCH_OPT_095, -95, "Benchmark option 95" )
+INCFG_REQUIRE( unsigned int, BENCH_OPT_096, 96u, "Benchmark option 96" )
+INCFG_REQUIRE( double, BENCH_OPT_097, 97.5, "Benchmark option 97" )
+INCFG_REQUIRE( bool, BENCH_OPT_098, false, "Benchmark option 98" )
+INCFG_REQUIRE( std::string, BENCH_OPT_099, "value_99", "Benchmark option 99" )
+
+
+size_t bench_compile_100_options()
+{
+    size_t acc = 0;
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_000 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_001 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_002 ) );
+    acc += INCFG_GET( BENCH_OPT_003 ) ? 1 : 0;
+    acc += INCFG_GET( BENCH_OPT_004 ).length();
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_005 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_006 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_007 ) );
+    acc += INCFG_GET( BENCH_OPT_008 ) ? 1 : 0;
+    acc += INCFG_GET( BENCH_OPT_009 ).length();
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_010 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_011 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_012 ) );
+    acc += INCFG_GET( BENCH_OPT_013 ) ? 1 : 0;
+    acc += INCFG_GET( BENCH_OPT_014 ).length();
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_015 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_016 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_017 ) );
+    acc += INCFG_GET( BENCH_OPT_018 ) ? 1 : 0;
+    acc += INCFG_GET( BENCH_OPT_019 ).length();
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_020 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_021 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_022 ) );
+    acc += INCFG_GET( BENCH_OPT_023 ) ? 1 : 0;
+    acc += INCFG_GET( BENCH_OPT_024 ).length();
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_025 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_026 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_027 ) );
+    acc += INCFG_GET( BENCH_OPT_028 ) ? 1 : 0;
+    acc += INCFG_GET( BENCH_OPT_029 ).length();
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_030 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_031 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_032 ) );
+    acc += INCFG_GET( BENCH_OPT_033 ) ? 1 : 0;
+    acc += INCFG_GET( BENCH_OPT_034 ).length();
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_035 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_036 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_037 ) );
+    acc += INCFG_GET( BENCH_OPT_038 ) ? 1 : 0;
+    acc += INCFG_GET( BENCH_OPT_039 ).length();
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_040 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_041 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_042 ) );
+    acc += INCFG_GET( BENCH_OPT_043 ) ? 1 : 0;
+    acc += INCFG_GET( BENCH_OPT_044 ).length();
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_045 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_046 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_047 ) );
+    acc += INCFG_GET( BENCH_OPT_048 ) ? 1 : 0;
+    acc += INCFG_GET( BENCH_OPT_049 ).length();
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_050 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_051 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_052 ) );
+    acc += INCFG_GET( BENCH_OPT_053 ) ? 1 : 0;
+    acc += INCFG_GET( BENCH_OPT_054 ).length();
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_055 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_056 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_057 ) );
+    acc += INCFG_GET( BENCH_OPT_058 ) ? 1 : 0;
+    acc += INCFG_GET( BENCH_OPT_059 ).length();
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_060 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_061 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_062 ) );
+    acc += INCFG_GET( BENCH_OPT_063 ) ? 1 : 0;
+    acc += INCFG_GET( BENCH_OPT_064 ).length();
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_065 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_066 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_067 ) );
+    acc += INCFG_GET( BENCH_OPT_068 ) ? 1 : 0;
+    acc += INCFG_GET( BENCH_OPT_069 ).length();
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_070 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_071 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_072 ) );
+    acc += INCFG_GET( BENCH_OPT_073 ) ? 1 : 0;
+    acc += INCFG_GET( BENCH_OPT_074 ).length();
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_075 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_076 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_077 ) );
+    acc += INCFG_GET( BENCH_OPT_078 ) ? 1 : 0;
+    acc += INCFG_GET( BENCH_OPT_079 ).length();
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_080 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_081 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_082 ) );
+    acc += INCFG_GET( BENCH_OPT_083 ) ? 1 : 0;
+    acc += INCFG_GET( BENCH_OPT_084 ).length();
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_085 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_086 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_087 ) );
+    acc += INCFG_GET( BENCH_OPT_088 ) ? 1 : 0;
+    acc += INCFG_GET( BENCH_OPT_089 ).length();
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_090 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_091 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_092 ) );
+    acc += INCFG_GET( BENCH_OPT_093 ) ? 1 : 0;
+    acc += INCFG_GET( BENCH_OPT_094 ).length();
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_095 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_096 ) );
+    acc += static_cast<size_t>( INCFG_GET( BENCH_OPT_097 ) );
+    acc += INCFG_GET( BENCH_OPT_098 ) ? 1 : 0;
+    acc += INCFG_GET( BENCH_OPT_099 ).length();
+    return acc;
+}
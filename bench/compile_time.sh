@@ -0,0 +1,34 @@
+#!/bin/sh
+#
+# Compile-time benchmark for incfg.hpp
+#
+# Compiles bench/compile_100_options.cpp (100 INCFG_REQUIRE declarations and
+# 100 INCFG_GET reads) several times and reports the average wall time, together
+# with the size of the preprocessed translation unit.
+#
+# Usage: bench/compile_time.sh [compiler] [repetitions]
+#
+# Reference (g++ 12 -O2): 30316 preprocessed lines, 420 ms, 21 KB of text.
+# Options of the fundamental and unit types are instantiated in incfg.cpp:
+# the TU only instantiates their read path.
+#
+
+CXX=${1:-c++}
+REPS=${2:-10}
+DIR=$(cd "$(dirname "$0")" && pwd)
+SRC="$DIR/compile_100_options.cpp"
+OUT=$(mktemp)
+
+LINES=$($CXX -std=c++17 -E "$SRC" | wc -l)
+
+START=$(date +%s%N)
+i=0
+while [ $i -lt "$REPS" ]; do
+    $CXX -std=c++17 -O2 -c "$SRC" -o "$OUT" || exit 1
+    i=$((i+1))
+done
+END=$(date +%s%N)
+
+echo "preprocessed lines: $LINES"
+echo "average compile time: $(( (END-START)/REPS/1000000 )) ms ($REPS runs, $CXX -O2)"
+rm -f "$OUT"
@@ -0,0 +1,216 @@
+/*
+ * Synthetic options and configuration generator for the scale benchmarks
+ *
+ * Given a number of options, writes:
+ *
+ * - C++ translation units declaring them with INCFG_REQUIRE, GEN_CHUNK options per file
+ *   (GEN_TU_PREFIX + "<chunk index>.cpp"), each with a function reading all its options
+ * - a schema file listing them one per line (type, key, default value and description separated
+ *   by tabs), used to register the options at runtime when there are too many to compile
+ * - a configuration file with GEN_CONFIG_LINES assignments, GEN_COMMENT_RATE comment lines per
+ *   assignment, string values quoted with probability GEN_QUOTE_RATE and a fraction GEN_ERROR_RATE
+ *   of invalid lines (unknown keys, missing '=', malformed values)
+ *
+ * Each output is skipped if its path is empty. Option types cycle through int, unsigned int, long,
+ * double, bool, std::string and std::chrono::milliseconds.
+ */
+
+#include "incfg.hpp"
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+INCFG_REQUIRE( unsigned int, GEN_OPTIONS, 1000, "Number of options" )
+INCFG_REQUIRE( unsigned int, GEN_SEED, 1, "Random seed" )
+INCFG_REQUIRE( std::string, GEN_KEY_PREFIX, "SCALE_", "Prefix of the option keys" )
+INCFG_REQUIRE( std::string, GEN_TU_PREFIX, "", "Path prefix of the generated translation units" )
+INCFG_REQUIRE( unsigned int, GEN_CHUNK, 1000, "Options per translation unit" )
+INCFG_REQUIRE( std::string, GEN_SCHEMA, "", "Path of the generated schema file" )
+INCFG_REQUIRE( std::string, GEN_CONFIG, "", "Path of the generated configuration file" )
+INCFG_REQUIRE( unsigned int, GEN_CONFIG_LINES, 0, "Number of assignments in the configuration file (0: one per option)" )
+INCFG_REQUIRE( double, GEN_COMMENT_RATE, 0.5, "Comment lines per assignment" )
+INCFG_REQUIRE( double, GEN_QUOTE_RATE, 0.5, "Probability of quoting a string value" )
+INCFG_REQUIRE( double, GEN_ERROR_RATE, 0.0, "Probability of an invalid line" )
+
+
+namespace {
+
+const unsigned int NUM_TYPES = 7;
+const char* const type_names[ NUM_TYPES ] = { "int", "unsigned int", "long", "double", "bool", "std::string", "std::chrono::milliseconds" };
+
+
+std::string key_of( unsigned int idx )
+{
+    std::stringstream ss;
+    ss << INCFG_GET( GEN_KEY_PREFIX ) << idx;
+    return ss.str();
+}
+
+
+std::string random_word( std::mt19937_64& rng )
+{
+    static const char letters[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+    std::string word( 3 + rng() % 10, ' ' );
+    for( size_t i=0; i<word.length(); ++i )
+        word[i] = letters[ rng() % (sizeof(letters)-1) ];
+    return word;
+}
+
+
+// A random value of the type of the idx^th option, as written in a configuration file
+std::string random_value( unsigned int idx, std::mt19937_64& rng, bool quote )
+{
+    std::stringstream ss;
+    switch( idx % NUM_TYPES )
+    {
+    case 0: ss << static_cast< int >( rng() % 2000001 ) - 1000000; break;
+    case 1: ss << rng() % 1000001; break;
+    case 2: ss << static_cast< long >( rng() % 2000000000001ULL ) - 1000000000000L; break;
+    case 3: ss.precision( 10 ); ss << std::uniform_real_distribution< double >( -1e6, 1e6 )( rng ); break;
+    case 4: ss << ( rng() % 2 ? "true" : "false" ); break;
+    case 5:
+        if( quote )
+            ss << '"' << random_word( rng ) << ' ' << random_word( rng ) << '"';
+        else
+            ss << random_word( rng );
+        break;
+    default: ss << rng() % 10000 << ( rng() % 2 ? "ms" : "s" ); break;
+    }
+    return ss.str();
+}
+
+
+// The default value of the idx^th option, as a C++ expression
+std::string default_expression( unsigned int idx )
+{
+    std::stringstream ss;
+    switch( idx % NUM_TYPES )
+    {
+    case 0: ss << static_cast< int >( idx ); break;
+    case 1: ss << idx << "u"; break;
+    case 2: ss << idx << "L"; break;
+    case 3: ss << idx << ".5"; break;
+    case 4: ss << ( idx % 2 ? "true" : "false" ); break;
+    case 5: ss << "\"value" << idx << '"'; break;
+    default: ss << "std::chrono::milliseconds( " << idx << " )"; break;
+    }
+    return ss.str();
+}
+
+
+// The default value of the idx^th option, as a string parsed by its type
+std::string default_string( unsigned int idx )
+{
+    std::stringstream ss;
+    switch( idx % NUM_TYPES )
+    {
+    case 3: ss << idx << ".5"; break;
+    case 4: ss << ( idx % 2 ? "true" : "false" ); break;
+    case 5: ss << "value" << idx; break;
+    case 6: ss << idx << "ms"; break;
+    default: ss << idx; break;
+    }
+    return ss.str();
+}
+
+
+void write_translation_units( const std::string& prefix, unsigned int num_options, unsigned int chunk )
+{
+    for( unsigned int first=0, tu=0; first<num_options; first+=chunk, ++tu )
+    {
+        const unsigned int last = std::min( first+chunk, num_options );
+        std::stringstream path;
+        path << prefix << tu << ".cpp";
+        std::ofstream ofs( path.str().c_str() );
+
+        ofs << "// Generated by incfgGenerate: options " << first << ".." << last-1 << "\n\n";
+        ofs << "#include \"incfg.hpp\"\n#include \"incfg_units.hpp\"\n\n";
+        for( unsigned int idx=first; idx<last; ++idx )
+            ofs << "INCFG_REQUIRE( " << type_names[ idx % NUM_TYPES ] << ", " << key_of( idx ) << ", "
+                << default_expression( idx ) << ", \"Generated option " << idx << "\" )\n";
+
+        // Reads every option of the chunk, so the benchmarks can time INCFG_GET
+        ofs << "\ndouble incfg_generated_read_" << tu << "()\n{\n    double sum = 0;\n";
+        for( unsigned int idx=first; idx<last; ++idx )
+        {
+            const std::string get = "INCFG_GET( " + key_of( idx ) + " )";
+            switch( idx % NUM_TYPES )
+            {
+            case 5: ofs << "    sum += " << get << ".length();\n"; break;
+            case 6: ofs << "    sum += " << get << ".count();\n"; break;
+            default: ofs << "    sum += " << get << ";\n"; break;
+            }
+        }
+        ofs << "    return sum;\n}\n";
+    }
+}
+
+
+void write_schema( const std::string& path, unsigned int num_options )
+{
+    std::ofstream ofs( path.c_str() );
+    for( unsigned int idx=0; idx<num_options; ++idx )
+        ofs << type_names[ idx % NUM_TYPES ] << '\t' << key_of( idx ) << '\t' << default_string( idx )
+            << "\tGenerated option " << idx << '\n';
+}
+
+
+void write_config( const std::string& path, unsigned int num_options, unsigned int lines, std::mt19937_64& rng )
+{
+    std::ofstream ofs( path.c_str() );
+    std::uniform_real_distribution< double > uniform( 0.0, 1.0 );
+    double comments = 0;
+
+    for( unsigned int line=0; line<lines; ++line )
+    {
+        for( comments += INCFG_GET( GEN_COMMENT_RATE ); comments >= 1.0; comments -= 1.0 )
+            ofs << "# " << random_word( rng ) << ' ' << random_word( rng ) << '\n';
+
+        const unsigned int idx = lines > num_options ? static_cast< unsigned int >( rng() % num_options ) : line;
+        const bool quote = uniform( rng ) < INCFG_GET( GEN_QUOTE_RATE );
+
+        if( uniform( rng ) < INCFG_GET( GEN_ERROR_RATE ) )
+        {
+            switch( rng() % 3 )
+            {
+            case 0: ofs << "UNKNOWN_" << random_word( rng ) << " = " << random_value( idx, rng, quote ) << '\n'; break;
+            case 1: ofs << key_of( idx ) << ' ' << random_value( idx, rng, quote ) << '\n'; break;
+            default: ofs << key_of( idx ) << " = " << ( idx % NUM_TYPES == 5 ? "\"unterminated" : "not_a_value" ) << '\n'; break;
+            }
+            continue;
+        }
+
+        ofs << key_of( idx ) << " = " << random_value( idx, rng, quote ) << '\n';
+    }
+}
+
+}
+
+
+int main( int argc, char* argv[] )
+{
+    try
+    {
+        incfg::ConfigOptions::instance().load( argc, argv );
+    }
+    catch( std::exception& ex )
+    {
+        std::cerr << ex.what() << std::endl;
+        return 1;
+    }
+
+    const unsigned int num_options = std::max( INCFG_GET( GEN_OPTIONS ), 1u );
+    std::mt19937_64 rng( INCFG_GET( GEN_SEED ) );
+
+    if( !INCFG_GET( GEN_TU_PREFIX ).empty() )
+        write_translation_units( INCFG_GET( GEN_TU_PREFIX ), num_options, std::max( INCFG_GET( GEN_CHUNK ), 1u ) );
+
+    if( !INCFG_GET( GEN_SCHEMA ).empty() )
+        write_schema( INCFG_GET( GEN_SCHEMA ), num_options );
+
+    if( !INCFG_GET( GEN_CONFIG ).empty() )
+        write_config( INCFG_GET( GEN_CONFIG ), num_options, INCFG_GET( GEN_CONFIG_LINES ) ? INCFG_GET( GEN_CONFIG_LINES ) : num_options, rng );
+
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * NUMA replicas benchmark
+ *
+ * Reader threads, each pinned to a different CPU, read a few published options in a tight loop
+ * while a writer thread reloads them periodically. Run it with and without replicas to compare
+ * the read throughput, eg. on a two sockets machine:
+ *
+ *     incfgBenchNuma
+ *     incfgBenchNuma --BENCH_REPLICAS
+ *
+ * BENCH_EMULATED_NODES splits the CPUs in emulated nodes, to exercise the replicas on a single node machine.
+ */
+
+#include "incfg.hpp"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+INCFG_REQUIRE( unsigned int, BENCH_THREADS, 0, "Number of reader threads (0: one per available CPU)" )
+INCFG_REQUIRE( unsigned int, BENCH_SECONDS, 2, "Duration of the benchmark" )
+INCFG_REQUIRE( unsigned int, BENCH_RELOAD_US, 1000, "Interval between two reloads, in microseconds (0: no reloads)" )
+INCFG_REQUIRE( bool, BENCH_REPLICAS, false, "Enable NUMA replicas" )
+INCFG_REQUIRE( unsigned int, BENCH_EMULATED_NODES, 0, "Number of emulated NUMA nodes (0: actual topology)" )
+
+INCFG_REQUIRE( int, HOT_A, 1, "Option read by the benchmark" )
+INCFG_REQUIRE( long, HOT_B, 2, "Option read by the benchmark" )
+INCFG_REQUIRE( double, HOT_C, 3.0, "Option read by the benchmark" )
+INCFG_REQUIRE( unsigned int, HOT_D, 4, "Option read by the benchmark" )
+
+
+namespace {
+
+std::vector< int > available_cpus()
+{
+    std::vector< int > cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO( &set );
+    if( sched_getaffinity( 0, sizeof(set), &set ) == 0 )
+    {
+        for( int cpu=0; cpu<CPU_SETSIZE; ++cpu )
+            if( CPU_ISSET( cpu, &set ) )
+                cpus.push_back( cpu );
+    }
+#endif
+    if( cpus.empty() )
+        cpus.push_back( 0 );
+    return cpus;
+}
+
+
+void pin_to( int cpu )
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO( &set );
+    CPU_SET( cpu, &set );
+    pthread_setaffinity_np( pthread_self(), sizeof(set), &set );
+#else
+    (void)cpu;
+#endif
+}
+
+}
+
+
+int main( int argc, char* argv[] )
+{
+    incfg::ConfigOptions& co = incfg::ConfigOptions::instance();
+    co.load( argc, argv );
+
+    if( INCFG_GET( BENCH_REPLICAS ) )
+        co.enable_numa_replicas( INCFG_GET( BENCH_EMULATED_NODES ) );
+
+    const std::vector< int > cpus = available_cpus();
+    const unsigned int nthreads = INCFG_GET( BENCH_THREADS ) ? INCFG_GET( BENCH_THREADS ) : static_cast< unsigned int >( cpus.size() );
+
+    std::atomic< bool > running( true );
+    std::vector< unsigned long long > reads( nthreads, 0 );
+    std::vector< std::thread > readers;
+    volatile double sink = 0;
+
+    for( unsigned int t=0; t<nthreads; ++t )
+    {
+        readers.push_back( std::thread( [&, t]()
+        {
+            pin_to( cpus[ t % cpus.size() ] );
+            co.refresh_thread_node();
+
+            unsigned long long count = 0;
+            double acc = 0;
+            while( running.load( std::memory_order_relaxed ) )
+            {
+                for( int i=0; i<64; ++i )
+                    acc += INCFG_GET( HOT_A ) + INCFG_GET( HOT_B ) + INCFG_GET( HOT_C ) + INCFG_GET( HOT_D );
+                count += 64;
+            }
+            sink = sink + acc;
+            reads[t] = count;
+        } ) );
+    }
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const std::chrono::steady_clock::time_point end = start + std::chrono::seconds( INCFG_GET( BENCH_SECONDS ) );
+    unsigned long long reloads = 0;
+    while( std::chrono::steady_clock::now() < end )
+    {
+        if( INCFG_GET( BENCH_RELOAD_US ) == 0 )
+        {
+            std::this_thread::sleep_until( end );
+            break;
+        }
+
+        std::this_thread::sleep_for( std::chrono::microseconds( INCFG_GET( BENCH_RELOAD_US ) ) );
+        {
+            incfg::ConfigOptions::Publication publication( co );
+            INCFG_SET( HOT_A, INCFG_GET( HOT_A ) + 1 );
+            INCFG_SET( HOT_B, INCFG_GET( HOT_B ) + 1 );
+            INCFG_SET( HOT_C, INCFG_GET( HOT_C ) + 1 );
+            INCFG_SET( HOT_D, INCFG_GET( HOT_D ) + 1 );
+        }
+        ++reloads;
+    }
+    running.store( false );
+
+    unsigned long long total = 0;
+    for( unsigned int t=0; t<nthreads; ++t )
+    {
+        readers[t].join();
+        total += reads[t];
+    }
+
+    const double seconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+    std::cout << "replicas: " << co.numa_replicas() << "  threads: " << nthreads << "  reloads: " << reloads << std::endl;
+    std::cout << "reads (4 options each): " << total / seconds / 1e6 << " M/s, "
+              << total / seconds / nthreads / 1e6 << " M/s per thread" << std::endl;
+    return 0;
+}
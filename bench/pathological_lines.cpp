@@ -0,0 +1,60 @@
+/*
+ * Tokenizer benchmark on adversarial lines
+ *
+ * Loads single lines of growing size (1 to 16 MiB) made of: spaces inside an unquoted value, escaped
+ * quotes inside a quoted value, whitespace only, and a huge key without '='. The throughput should
+ * stay the same at every size, as each line is tokenized in a single scan.
+ */
+
+#include "incfg.hpp"
+#include <chrono>
+#include <iostream>
+#include <string>
+
+INCFG_REQUIRE( std::string, PATHOLOGICAL, "", "Option receiving the pathological values" )
+
+
+namespace {
+
+std::string repeat( const std::string& pattern, size_t bytes )
+{
+    std::string out;
+    out.reserve( bytes + pattern.length() );
+    while( out.length() < bytes )
+        out += pattern;
+    return out;
+}
+
+
+void run( const char* name, const std::string& line )
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::string text( line );
+    try
+    {
+        incfg::ConfigOptions::instance().load( text );
+    }
+    catch( std::exception& )
+    {
+        // the huge key is invalid on purpose
+    }
+    const double seconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+    std::cout << "  " << name << ": " << line.length() / seconds / (1 << 20) << " MiB/s" << std::endl;
+}
+
+}
+
+
+int main()
+{
+    for( size_t mib=1; mib<=16; mib*=2 )
+    {
+        const size_t bytes = mib << 20;
+        std::cout << mib << " MiB line" << std::endl;
+        run( "unquoted value with spaces", "PATHOLOGICAL = " + repeat( "a ", bytes ) + "\n" );
+        run( "quoted value with escaped quotes", "PATHOLOGICAL = \"" + repeat( "\\\"", bytes ) + "\"\n" );
+        run( "whitespace only", repeat( " \t", bytes ) + "\n" );
+        run( "key without '='", repeat( "k", bytes ) + "\n" );
+    }
+    return 0;
+}
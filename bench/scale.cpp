@@ -0,0 +1,177 @@
+/*
+ * Scale benchmark: registration, loading, memory usage, dumping and lookups of many options
+ *
+ * Inputs are produced by incfgGenerate (See bench/generate_options.cpp and bench/scale.sh):
+ *
+ * - BENCH_SCHEMA lists the options. Those not already declared by a linked translation unit are
+ *   registered at runtime as TypedOption objects, so that 100k or 1M options can be measured
+ *   without compiling them.
+ * - BENCH_CONFIG is loaded in blocks of BENCH_BLOCK lines. A block returning an error is loaded
+ *   again line by line, so that invalid lines are counted without stopping the load.
+ *
+ * When built with INCFG_BENCH_GENERATED_TUS, the generated translation units are linked as well
+ * and INCFG_GET is timed on all of their options.
+ */
+
+#include "incfg.hpp"
+#include "incfg_units.hpp"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+INCFG_REQUIRE( std::string, BENCH_SCHEMA, "", "Schema file listing the options" )
+INCFG_REQUIRE( std::string, BENCH_CONFIG, "", "Configuration file to load" )
+INCFG_REQUIRE( unsigned int, BENCH_BLOCK, 1000, "Lines loaded at once" )
+INCFG_REQUIRE( unsigned int, BENCH_LOOKUPS, 1000000, "Number of lookups by key" )
+
+#ifdef INCFG_BENCH_GENERATED_TUS
+double incfg_generated_read_0();
+#endif
+
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+
+double elapsed_ms( Clock::time_point start )
+{
+    return std::chrono::duration< double, std::milli >( Clock::now() - start ).count();
+}
+
+
+template <typename T>
+void register_option( const std::string& key, const std::string& default_value, const std::string& description )
+{
+    new incfg::TypedOption< T >( key.c_str(), incfg::from_string_helper< T >( default_value, T() ), description.c_str() );
+}
+
+
+// Registers the options of the schema not declared yet, and returns all the keys
+std::vector< std::string > register_schema( const std::string& path, size_t& registered )
+{
+    std::vector< std::string > keys;
+    std::ifstream ifs( path.c_str() );
+    std::string line;
+    registered = 0;
+
+    while( std::getline( ifs, line ) )
+    {
+        std::stringstream ss( line );
+        std::string type, key, default_value, description;
+        std::getline( ss, type, '\t' );
+        std::getline( ss, key, '\t' );
+        std::getline( ss, default_value, '\t' );
+        std::getline( ss, description );
+        keys.push_back( key );
+
+        if( incfg::ConfigOptions::instance().get( key ) )
+            continue;
+
+        if( type == "int" ) register_option< int >( key, default_value, description );
+        else if( type == "unsigned int" ) register_option< unsigned int >( key, default_value, description );
+        else if( type == "long" ) register_option< long >( key, default_value, description );
+        else if( type == "double" ) register_option< double >( key, default_value, description );
+        else if( type == "bool" ) register_option< bool >( key, default_value, description );
+        else if( type == "std::string" ) register_option< std::string >( key, default_value, description );
+        else register_option< std::chrono::milliseconds >( key, default_value, description );
+        ++registered;
+    }
+    return keys;
+}
+
+
+// Loads a configuration file in blocks, and returns the number of invalid lines
+size_t load_config( const std::string& path, size_t& lines )
+{
+    std::ifstream ifs( path.c_str() );
+    std::vector< std::string > block;
+    std::string line;
+    size_t errors = 0;
+    lines = 0;
+
+    while( ifs.good() )
+    {
+        block.clear();
+        while( block.size() < INCFG_GET( BENCH_BLOCK ) && std::getline( ifs, line ) )
+            block.push_back( line + "\n" );
+        lines += block.size();
+
+        std::string text;
+        for( size_t i=0; i<block.size(); ++i )
+            text += block[i];
+
+        if( !incfg::ConfigOptions::instance().try_load( text ) )
+        {
+            for( size_t i=0; i<block.size(); ++i )
+                errors += !incfg::ConfigOptions::instance().try_load( block[i] );
+        }
+    }
+    return errors;
+}
+
+}
+
+
+int main( int argc, char* argv[] )
+{
+    incfg::ConfigOptions& co = incfg::ConfigOptions::instance();
+    co.load( argc, argv );
+
+    Clock::time_point start = Clock::now();
+    size_t registered = 0;
+    const std::vector< std::string > keys = register_schema( INCFG_GET( BENCH_SCHEMA ), registered );
+    std::cout << "options: " << co.size() << " (" << registered << " registered at runtime in " << elapsed_ms( start ) << " ms)" << std::endl;
+
+    if( !INCFG_GET( BENCH_CONFIG ).empty() )
+    {
+        size_t lines = 0;
+        start = Clock::now();
+        const size_t errors = load_config( INCFG_GET( BENCH_CONFIG ), lines );
+        std::cout << "load: " << lines << " lines (" << errors << " invalid) in " << elapsed_ms( start ) << " ms" << std::endl;
+    }
+
+    const incfg::MemoryUsage usage = co.memory_usage();
+    std::cout << "memory: " << usage.total() << " bytes (registry " << usage.registry << ", keys " << usage.keys
+              << ", options " << usage.options << ", descriptions " << usage.descriptions
+              << ", string values " << usage.string_values << ")" << std::endl;
+
+    start = Clock::now();
+    const size_t config_size = co.to_config_string().size();
+    std::cout << "to_config_string: " << config_size << " bytes in " << elapsed_ms( start ) << " ms" << std::endl;
+
+    start = Clock::now();
+    const size_t json_size = co.to_json().size();
+    std::cout << "to_json: " << json_size << " bytes in " << elapsed_ms( start ) << " ms" << std::endl;
+
+    start = Clock::now();
+    const size_t binary_size = co.to_binary().size();
+    std::cout << "to_binary: " << binary_size << " bytes in " << elapsed_ms( start ) << " ms" << std::endl;
+
+    if( !keys.empty() )
+    {
+        std::mt19937_64 rng( 1 );
+        std::vector< const std::string* > order( INCFG_GET( BENCH_LOOKUPS ) );
+        for( size_t i=0; i<order.size(); ++i )
+            order[i] = &keys[ rng() % keys.size() ];
+
+        size_t found = 0;
+        start = Clock::now();
+        for( size_t i=0; i<order.size(); ++i )
+            found += co.get( *order[i] ) != 0;
+        const double ms = elapsed_ms( start );
+        std::cout << "lookups by key: " << found << " in " << ms << " ms (" << ms * 1e6 / std::max< size_t >( order.size(), 1 ) << " ns each)" << std::endl;
+    }
+
+#ifdef INCFG_BENCH_GENERATED_TUS
+    start = Clock::now();
+    double sum = 0;
+    for( int i=0; i<100; ++i )
+        sum += incfg_generated_read_0();
+    std::cout << "INCFG_GET of every declared option x100: " << elapsed_ms( start ) << " ms (checksum " << sum << ")" << std::endl;
+#endif
+    return 0;
+}
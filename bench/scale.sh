@@ -0,0 +1,35 @@
+#!/bin/sh
+#
+# Scale benchmark for incfg
+#
+# Generates schemas and configuration files with incfgGenerate, then measures registration,
+# loading, dumping and lookups with 10, 1k, 100k and 1M options. The 10 and 1k cases are
+# also run with the options declared by generated translation units (incfgBenchScale_<N>).
+#
+# Usage: bench/scale.sh <build dir> [comment rate] [quote rate] [error rate]
+#
+# The build directory must be configured with -DINCFG_BUILD_BENCHMARKS=ON (preferably with
+# -DCMAKE_BUILD_TYPE=Release).
+#
+
+BUILD=${1:?usage: $0 <build dir> [comment rate] [quote rate] [error rate]}
+COMMENTS=${2:-0.5}
+QUOTES=${3:-0.5}
+ERRORS=${4:-0.01}
+TMP=$(mktemp -d)
+
+for N in 10 1000 100000 1000000; do
+    "$BUILD/incfgGenerate" --GEN_OPTIONS $N --GEN_SCHEMA "$TMP/scale.schema" --GEN_CONFIG "$TMP/scale.cfg" \
+        --GEN_COMMENT_RATE "$COMMENTS" --GEN_QUOTE_RATE "$QUOTES" --GEN_ERROR_RATE "$ERRORS" || exit 1
+
+    echo "== $N options, registered at runtime"
+    "$BUILD/incfgBenchScale" --BENCH_SCHEMA "$TMP/scale.schema" --BENCH_CONFIG "$TMP/scale.cfg" || exit 1
+
+    if [ -x "$BUILD/incfgBenchScale_$N" ]; then
+        echo "== $N options, declared with INCFG_REQUIRE"
+        "$BUILD/incfgBenchScale_$N" --BENCH_SCHEMA "$TMP/scale.schema" --BENCH_CONFIG "$TMP/scale.cfg" || exit 1
+    fi
+    echo
+done
+
+rm -rf "$TMP"
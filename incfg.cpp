@@ -26,142 +26,2048 @@ THE SOFTWARE.
 */
 
 #include "incfg.hpp"
+#ifndef INCFG_HEADER_ONLY
+#include "incfg_units.hpp"
+#endif
 #include <iostream>
+#include <sstream>
+#include <map>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <climits>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <set>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define INCFG_HAS_POSIX_IO
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 
 namespace incfg {
 
 
-ConfigOptions& ConfigOptions::instance()
+INCFG_INLINE std::string detail::write_to_stream( const void* val, void (*writer)( std::ostream&, const void* ) )
+{
+    std::stringstream ss;
+    writer( ss, val );
+    return ss.str();
+}
+
+
+INCFG_INLINE bool detail::read_from_stream( const std::string& str, void* val, void (*reader)( std::istream&, void* ) )
+{
+    std::stringstream ss(str);
+    reader( ss, val );
+    return !ss.fail();
+}
+
+
+#define INCFG_DEFINE_STREAM_CONVERSIONS( TYPE ) \
+template < > INCFG_INLINE std::string to_string_helper< TYPE >( TYPE val ) \
+{ \
+    return detail::write_to_stream( &val, &detail::stream_writer< TYPE > ); \
+} \
+template < > INCFG_INLINE Expected< TYPE > parse_value< TYPE >( const std::string& str, const TYPE& mytype ) \
+{ \
+    TYPE val; \
+    if( !detail::read_from_stream( str, &val, &detail::stream_reader< TYPE > ) ) \
+        return Unexpected("Unable to parse "+str+" to its defined type"); \
+    return val; \
+} \
+template < > INCFG_INLINE TYPE from_string_helper< TYPE >( std::string str, const TYPE& mytype ) \
+{ \
+    return detail::value_or_throw( parse_value< TYPE >( str, mytype ) ); \
+}
+
+INCFG_DEFINE_STREAM_CONVERSIONS( char )
+INCFG_DEFINE_STREAM_CONVERSIONS( signed char )
+INCFG_DEFINE_STREAM_CONVERSIONS( unsigned char )
+INCFG_DEFINE_STREAM_CONVERSIONS( short )
+INCFG_DEFINE_STREAM_CONVERSIONS( unsigned short )
+INCFG_DEFINE_STREAM_CONVERSIONS( int )
+INCFG_DEFINE_STREAM_CONVERSIONS( unsigned int )
+INCFG_DEFINE_STREAM_CONVERSIONS( long )
+INCFG_DEFINE_STREAM_CONVERSIONS( unsigned long )
+INCFG_DEFINE_STREAM_CONVERSIONS( long long )
+INCFG_DEFINE_STREAM_CONVERSIONS( unsigned long long )
+INCFG_DEFINE_STREAM_CONVERSIONS( float )
+INCFG_DEFINE_STREAM_CONVERSIONS( double )
+INCFG_DEFINE_STREAM_CONVERSIONS( long double )
+
+#undef INCFG_DEFINE_STREAM_CONVERSIONS
+
+
+#ifndef INCFG_HEADER_ONLY
+// Options of the fundamental and unit types (See INCFG_EXTERN_TYPED_OPTION)
+#define INCFG_DEFINE_TYPED_OPTION( TYPE ) \
+template class TypedOption< TYPE >;
+
+INCFG_DEFINE_TYPED_OPTION( bool )
+INCFG_DEFINE_TYPED_OPTION( char )
+INCFG_DEFINE_TYPED_OPTION( signed char )
+INCFG_DEFINE_TYPED_OPTION( unsigned char )
+INCFG_DEFINE_TYPED_OPTION( short )
+INCFG_DEFINE_TYPED_OPTION( unsigned short )
+INCFG_DEFINE_TYPED_OPTION( int )
+INCFG_DEFINE_TYPED_OPTION( unsigned int )
+INCFG_DEFINE_TYPED_OPTION( long )
+INCFG_DEFINE_TYPED_OPTION( unsigned long )
+INCFG_DEFINE_TYPED_OPTION( long long )
+INCFG_DEFINE_TYPED_OPTION( unsigned long long )
+INCFG_DEFINE_TYPED_OPTION( float )
+INCFG_DEFINE_TYPED_OPTION( double )
+INCFG_DEFINE_TYPED_OPTION( std::string )
+INCFG_DEFINE_TYPED_OPTION( std::chrono::nanoseconds )
+INCFG_DEFINE_TYPED_OPTION( std::chrono::microseconds )
+INCFG_DEFINE_TYPED_OPTION( std::chrono::milliseconds )
+INCFG_DEFINE_TYPED_OPTION( std::chrono::seconds )
+INCFG_DEFINE_TYPED_OPTION( std::chrono::minutes )
+INCFG_DEFINE_TYPED_OPTION( std::chrono::hours )
+INCFG_DEFINE_TYPED_OPTION( std::chrono::duration< double > )
+INCFG_DEFINE_TYPED_OPTION( ByteSize )
+
+#undef INCFG_DEFINE_TYPED_OPTION
+#endif
+
+
+/*
+ * The helpers of this file are inline functions of incfg::detail rather than members of an anonymous
+ * namespace: in header-only builds this file is included by every translation unit, and the inline
+ * definitions using them must refer to the same entities everywhere.
+ */
+namespace detail {
+
+struct QuantityUnit
+{
+    const char* suffix;
+    long double scale;  // base units (nanoseconds or bytes) per unit
+    bool canonical;     // used when formatting
+};
+
+// Sorted by decreasing scale, so that formatting picks the largest exact unit
+inline constexpr QuantityUnit duration_units[] = {
+    { "d", 86400E9L, true },
+    { "h", 3600E9L, true },
+    { "min", 60E9L, true },
+    { "m", 60E9L, false },
+    { "s", 1E9L, true },
+    { "ms", 1E6L, true },
+    { "us", 1E3L, true },
+    { "\xC2\xB5s", 1E3L, false },
+    { "ns", 1.0L, true },
+    { 0, 0, false }
+};
+
+inline constexpr QuantityUnit byte_units[] = {
+    { "PiB", 1125899906842624.0L, true },
+    { "P", 1125899906842624.0L, false },
+    { "PB", 1E15L, true },
+    { "TiB", 1099511627776.0L, true },
+    { "T", 1099511627776.0L, false },
+    { "TB", 1E12L, true },
+    { "GiB", 1073741824.0L, true },
+    { "G", 1073741824.0L, false },
+    { "GB", 1E9L, true },
+    { "MiB", 1048576.0L, true },
+    { "M", 1048576.0L, false },
+    { "MB", 1E6L, true },
+    { "KiB", 1024.0L, true },
+    { "K", 1024.0L, false },
+    { "k", 1024.0L, false },
+    { "kB", 1E3L, true },
+    { "KB", 1E3L, false },
+    { "B", 1.0L, true },
+    { 0, 0, false }
+};
+
+inline const QuantityUnit* quantity_units( QuantityKind kind )
+{
+    return kind==QUANTITY_DURATION ? duration_units : byte_units;
+}
+
+inline bool is_space( char c )
+{
+    return c==' ' || c=='\t';
+}
+
+}
+
+
+INCFG_INLINE bool detail::parse_quantity( const std::string& str, QuantityKind kind, long double& value, bool& has_unit )
+{
+    const char* curr = str.data();
+    const char* end = str.data()+str.length();
+
+    while( curr!=end && is_space(*curr) )
+        ++curr;
+    while( curr!=end && is_space(*(end-1)) )
+        --end;
+
+    bool negative = false;
+    if( curr!=end && *curr=='-' && kind==QUANTITY_DURATION )
+    {
+        negative = true;
+        ++curr;
+    }
+
+    // Integer and fractional parts are parsed separately to keep 64-bit integers exact
+    unsigned long long integer_part = 0;
+    std::from_chars_result res = std::from_chars( curr, end, integer_part );
+    if( res.ec!=std::errc() )
+        return false;
+    curr = res.ptr;
+    value = static_cast< long double >( integer_part );
+
+    if( curr!=end && *curr=='.' )
+    {
+        const char* frac_begin = ++curr;
+        long double scale = 1.0L;
+        long double fraction = 0.0L;
+        while( curr!=end && *curr>='0' && *curr<='9' )
+        {
+            scale /= 10.0L;
+            fraction += (*curr-'0')*scale;
+            ++curr;
+        }
+        if( curr==frac_begin )
+            return false;
+        value += fraction;
+    }
+
+    while( curr!=end && is_space(*curr) )
+        ++curr;
+
+    has_unit = curr!=end;
+    if( has_unit )
+    {
+        const size_t len = end-curr;
+        const QuantityUnit* unit = quantity_units( kind );
+        while( unit->suffix && ( std::strlen(unit->suffix)!=len || std::memcmp( unit->suffix, curr, len )!=0 ) )
+            ++unit;
+
+        if( !unit->suffix )
+            return false;
+
+        value *= unit->scale;
+    }
+
+    if( negative )
+        value = -value;
+
+    return true;
+}
+
+
+INCFG_INLINE std::string detail::format_quantity( long double value, QuantityKind kind )
+{
+    if( value==0 )
+        return kind==QUANTITY_DURATION ? std::string("0s") : std::string("0B");
+
+    const QuantityUnit* unit = quantity_units( kind );
+    const QuantityUnit* base = unit;
+    while( (base+1)->suffix )
+        ++base;
+
+    char buff[64];
+    char* curr = buff;
+    if( value<0 )
+    {
+        *curr++ = '-';
+        value = -value;
+    }
+
+    for( ; unit->suffix; ++unit )
+    {
+        if( !unit->canonical )
+            continue;
+
+        const long double count = value / unit->scale;
+        if( count==std::floor( count ) && count<=static_cast< long double >( ULLONG_MAX ) )
+        {
+            curr = std::to_chars( curr, buff+sizeof(buff), static_cast< unsigned long long >( count ) ).ptr;
+            return std::string( buff, curr ) + unit->suffix;
+        }
+    }
+
+    // Not a whole number of base units
+    curr = std::to_chars( curr, buff+sizeof(buff), static_cast< double >( value ) ).ptr;
+    return std::string( buff, curr ) + base->suffix;
+}
+
+
+INCFG_INLINE std::string detail::quote( const char* str, size_t len )
+{
+    std::string out;
+    out.reserve( len+2 );
+    out += '"';
+    for( size_t i=0; i<len; ++i )
+    {
+        switch( str[i] )
+        {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        default: out += str[i]; break;
+        }
+    }
+    out += '"';
+    return out;
+}
+
+
+
+namespace detail {
+
+// Tokens of a line of the text format
+struct LineTokens
+{
+    const char* key_begin;
+    const char* key_end;
+    std::string value;
+    const char* error;      // NULL unless the line is malformed
+};
+
+
+/*
+ * Tokenizes a line of the text format (without its '\n') in a single scan, without modifying it:
+ *
+ *     line   := ws* [ '#' any* | key ws* '=' ws* [ value ] ]
+ *     value  := '"' ( char | '\' char )* '"' ws*  |  unquoted value (trailing whitespace is not part of it)
+ *
+ * Spaces, tabs and carriage returns are whitespace. Returns false for blank and comment lines.
+ * Quoted values keep their quotes (so that string options can tell them apart) with the escapes
+ * \" \\ \n \r \t decoded. Other escapes are kept verbatim.
+ */
+inline bool tokenize_line( const char* p, const char* end, LineTokens& tok )
+{
+    enum State { LEADING, KEY, BEFORE_EQ, BEFORE_VALUE, UNQUOTED, QUOTED, ESCAPE, AFTER_QUOTE };
+    State state = LEADING;
+    const char* run = p;        // start of the characters of the value not appended yet
+    const char* last = p;       // end of the unquoted value
+    tok.value.clear();
+    tok.error = 0;
+
+    for( ; p!=end; ++p )
+    {
+        const char c = *p;
+        const bool space = c==' ' || c=='\t' || c=='\r';
+        switch( state )
+        {
+        case LEADING:
+            if( space )
+                break;
+            if( c=='#' )
+                return false;
+            if( c=='=' )
+            {
+                tok.error = "No key found (<key> = <value> expected)";
+                return true;
+            }
+            tok.key_begin = p;
+            state = KEY;
+            break;
+
+        case KEY:
+            if( c=='=' || space )
+            {
+                tok.key_end = p;
+                state = c=='=' ? BEFORE_VALUE : BEFORE_EQ;
+            }
+            break;
+
+        case BEFORE_EQ:
+            if( c=='=' )
+            {
+                state = BEFORE_VALUE;
+            }
+            else if( !space )
+            {
+                tok.error = "'=' expected after the key (<key> = <value> expected)";
+                return true;
+            }
+            break;
+
+        case BEFORE_VALUE:
+            if( space )
+                break;
+            if( c=='"' )
+            {
+                tok.value += '"';
+                run = p+1;
+                state = QUOTED;
+            }
+            else
+            {
+                run = p;
+                last = p+1;
+                state = UNQUOTED;
+            }
+            break;
+
+        case UNQUOTED:
+            if( !space )
+                last = p+1;
+            break;
+
+        case QUOTED:
+            if( c=='\\' || c=='"' )
+            {
+                tok.value.append( run, p );
+                if( c=='"' )
+                    tok.value += '"';
+                state = c=='"' ? AFTER_QUOTE : ESCAPE;
+            }
+            break;
+
+        case ESCAPE:
+            switch( c )
+            {
+            case 'n': tok.value += '\n'; break;
+            case 'r': tok.value += '\r'; break;
+            case 't': tok.value += '\t'; break;
+            case '"':
+            case '\\': tok.value += c; break;
+            default: tok.value += '\\'; tok.value += c; break;
+            }
+            run = p+1;
+            state = QUOTED;
+            break;
+
+        case AFTER_QUOTE:
+            if( !space )
+            {
+                tok.error = "Unexpected characters after a quoted value";
+                return true;
+            }
+            break;
+        }
+    }
+
+    switch( state )
+    {
+    case LEADING:
+        return false;
+    case KEY:
+    case BEFORE_EQ:
+        tok.error = "No '=' found (<key> = <value> expected)";
+        break;
+    case UNQUOTED:
+        tok.value.assign( run, last );
+        break;
+    case QUOTED:
+    case ESCAPE:
+        tok.error = "Unterminated quoted value";
+        break;
+    default:
+        break;
+    }
+    return true;
+}
+
+}
+
+
+namespace detail {
+
+/*
+ * Writes the typed option values as JSON literals
+ */
+class JsonWriter : public ValueWriter
+{
+public:
+    explicit JsonWriter( Sink& _out ) : out(_out) {}
+
+    void write_bool( bool val )
+    {
+        if( val )
+            out.write( "true", 4 );
+        else
+            out.write( "false", 5 );
+    }
+
+    void write_int( long long val )
+    {
+        char buff[32];
+        std::to_chars_result res = std::to_chars( buff, buff+sizeof(buff), val );
+        out.write( buff, res.ptr-buff );
+    }
+
+    void write_uint( unsigned long long val )
+    {
+        char buff[32];
+        std::to_chars_result res = std::to_chars( buff, buff+sizeof(buff), val );
+        out.write( buff, res.ptr-buff );
+    }
+
+    void write_real( double val )
+    {
+        if( !std::isfinite(val) )
+        {
+            out.write( "null", 4 );
+            return;
+        }
+        char buff[32];
+        std::to_chars_result res = std::to_chars( buff, buff+sizeof(buff), val );
+        out.write( buff, res.ptr-buff );
+    }
+
+    void write_string( const char* str, size_t len )
+    {
+        static const char hex[] = "0123456789abcdef";
+
+        out.write( "\"", 1 );
+        size_t run_start = 0;
+        for( size_t i=0; i<len; ++i )
+        {
+            const unsigned char c = static_cast<unsigned char>( str[i] );
+            if( c>=0x20 && c!='"' && c!='\\' )
+                continue;
+
+            // Flush the run of characters that need no escaping
+            out.write( str+run_start, i-run_start );
+            run_start = i+1;
+
+            switch( c )
+            {
+            case '"':  out.write( "\\\"", 2 ); break;
+            case '\\': out.write( "\\\\", 2 ); break;
+            case '\n': out.write( "\\n", 2 ); break;
+            case '\r': out.write( "\\r", 2 ); break;
+            case '\t': out.write( "\\t", 2 ); break;
+            case '\b': out.write( "\\b", 2 ); break;
+            case '\f': out.write( "\\f", 2 ); break;
+            default:
+                {
+                    char esc[6] = { '\\', 'u', '0', '0', hex[c>>4], hex[c&0xF] };
+                    out.write( esc, 6 );
+                }
+            }
+        }
+        out.write( str+run_start, len-run_start );
+        out.write( "\"", 1 );
+    }
+
+private:
+    Sink& out;
+};
+
+
+/*
+ * Writes the typed option values in the incfg binary format
+ * (See ConfigOptions::to_binary)
+ */
+class BinaryWriter : public ValueWriter
+{
+public:
+    enum Tag { TAG_BOOL=0, TAG_INT=1, TAG_UINT=2, TAG_REAL=3, TAG_STRING=4 };
+
+    explicit BinaryWriter( Sink& _out ) : out(_out) {}
+
+    void write_u8( unsigned char val )
+    {
+        out.write( reinterpret_cast<const char*>(&val), 1 );
+    }
+
+    void write_le( unsigned long long val, size_t nbytes )
+    {
+        char buff[8];
+        for( size_t i=0; i<nbytes; ++i )
+        {
+            buff[i] = static_cast<char>( (val >> (8*i)) & 0xFF );
+        }
+        out.write( buff, nbytes );
+    }
+
+    void write_bool( bool val )
+    {
+        write_u8( TAG_BOOL );
+        write_u8( val ? 1 : 0 );
+    }
+
+    void write_int( long long val )
+    {
+        write_u8( TAG_INT );
+        write_le( static_cast<unsigned long long>(val), 8 );
+    }
+
+    void write_uint( unsigned long long val )
+    {
+        write_u8( TAG_UINT );
+        write_le( val, 8 );
+    }
+
+    void write_real( double val )
+    {
+        unsigned long long bits;
+        std::memcpy( &bits, &val, sizeof(bits) );
+        write_u8( TAG_REAL );
+        write_le( bits, 8 );
+    }
+
+    void write_string( const char* str, size_t len )
+    {
+        if( len > 0xFFFFFFFFULL )
+            INCFG_THROW( std::length_error("Value too long for the binary format (4 GiB at most)") );
+
+        write_u8( TAG_STRING );
+        write_le( len, 4 );
+        out.write( str, len );
+    }
+
+private:
+    Sink& out;
+};
+
+
+/*
+ * Writes the typed option values as C++ literals (See ConfigOptions::to_frozen_header)
+ */
+class CppLiteralWriter : public ValueWriter
+{
+public:
+    explicit CppLiteralWriter( Sink& _out ) : out(_out) {}
+
+    void write_bool( bool val )
+    {
+        if( val )
+            out.write( "true", 4 );
+        else
+            out.write( "false", 5 );
+    }
+
+    void write_int( long long val )
+    {
+        if( val==LLONG_MIN )
+        {
+            static const char min_literal[] = "(-9223372036854775807LL - 1)";
+            out.write( min_literal, sizeof(min_literal)-1 );
+            return;
+        }
+        char buff[32];
+        std::to_chars_result res = std::to_chars( buff, buff+sizeof(buff), val );
+        out.write( buff, res.ptr-buff );
+        out.write( "LL", 2 );
+    }
+
+    void write_uint( unsigned long long val )
+    {
+        char buff[32];
+        std::to_chars_result res = std::to_chars( buff, buff+sizeof(buff), val );
+        out.write( buff, res.ptr-buff );
+        out.write( "ULL", 3 );
+    }
+
+    void write_real( double val )
+    {
+        if( std::isnan(val) )
+        {
+            static const char nan_literal[] = "std::numeric_limits< double >::quiet_NaN()";
+            out.write( nan_literal, sizeof(nan_literal)-1 );
+            return;
+        }
+        if( std::isinf(val) )
+        {
+            static const char inf_literal[] = "std::numeric_limits< double >::infinity()";
+            if( val<0 )
+                out.write( "-", 1 );
+            out.write( inf_literal, sizeof(inf_literal)-1 );
+            return;
+        }
+
+        char buff[32];
+        std::to_chars_result res = std::to_chars( buff, buff+sizeof(buff), val );
+        out.write( buff, res.ptr-buff );
+
+        // Integral values need a decimal point to be parsed as double literals
+        if( std::find_if( buff, res.ptr, []( char c ) { return c=='.' || c=='e'; } )==res.ptr )
+            out.write( ".0", 2 );
+    }
+
+    void write_string( const char*, size_t )
+    {
+        // Only options of fundamental types are frozen: writing nothing would generate an invalid header
+        INCFG_THROW( std::logic_error("String values cannot be written as frozen C++ literals") );
+    }
+
+private:
+    Sink& out;
+};
+
+
+inline void write_str( Sink& out, const char* str )
+{
+    out.write( str, std::strlen(str) );
+}
+
+}
+
+
+
+namespace detail {
+
+typedef std::atomic< unsigned long long > Word;
+
+
+#ifdef __linux__
+// Parses a sysfs cpu/node list like "0-3,8,10-11"
+inline std::vector< int > parse_id_list( const std::string& path )
+{
+    std::vector< int > ids;
+    std::ifstream ifs( path.c_str() );
+    std::string list;
+    if( !std::getline( ifs, list ) )
+        return ids;
+
+    std::stringstream ss( list );
+    std::string range;
+    while( std::getline( ss, range, ',' ) )
+    {
+        int first = 0;
+        int last = 0;
+        const char* begin = range.c_str();
+        const char* end = begin + range.length();
+        std::from_chars_result res = std::from_chars( begin, end, first );
+        if( res.ec != std::errc() )
+            continue;
+
+        last = first;
+        if( res.ptr != end && *res.ptr == '-' )
+            std::from_chars( res.ptr+1, end, last );
+
+        for( int id=first; id<=last; ++id )
+            ids.push_back( id );
+    }
+    return ids;
+}
+
+
+// Reads the first line of a file, returns false if it cannot be read
+inline bool read_first_line( const std::string& path, std::string& line )
+{
+    std::ifstream ifs( path.c_str() );
+    return static_cast< bool >( std::getline( ifs, line ) );
+}
+
+
+// Parses a size like "1048576", "48K" or "32M" (sysfs caches) in bytes, 0 if invalid
+inline unsigned long long parse_size( const std::string& str )
+{
+    unsigned long long value = 0;
+    const char* end = str.data() + str.length();
+    std::from_chars_result res = std::from_chars( str.data(), end, value );
+    if( res.ec != std::errc() )
+        return 0;
+
+    switch( res.ptr != end ? *res.ptr : 0 )
+    {
+    case 'K': return value << 10;
+    case 'M': return value << 20;
+    case 'G': return value << 30;
+    default: return value;
+    }
+}
+
+
+// Lowers the CPU quota and memory limit to those set in a cgroup directory, if any
+inline void read_cgroup_limits( const std::string& dir, bool v2, bool cpu, bool memory, Hardware& hw )
+{
+    std::string line;
+    if( cpu && v2 && read_first_line( dir + "/cpu.max", line ) )
+    {
+        // "<quota> <period>" or "max <period>"
+        double quota = 0;
+        double period = 0;
+        std::stringstream ss( line );
+        if( ss >> quota >> period && quota > 0 && period > 0 && ( hw.cpu_quota == 0 || quota/period < hw.cpu_quota ) )
+            hw.cpu_quota = quota/period;
+    }
+    std::string period_line;
+    if( cpu && !v2 && read_first_line( dir + "/cpu.cfs_quota_us", line ) && read_first_line( dir + "/cpu.cfs_period_us", period_line ) )
+    {
+        const double quota = std::atof( line.c_str() );
+        const double period = std::atof( period_line.c_str() );
+        if( quota > 0 && period > 0 && ( hw.cpu_quota == 0 || quota/period < hw.cpu_quota ) )
+            hw.cpu_quota = quota/period;
+    }
+    if( memory && read_first_line( dir + ( v2 ? "/memory.max" : "/memory.limit_in_bytes" ), line ) )
+    {
+        // "max" (v2) or a value close to the largest page-aligned integer (v1) mean unlimited
+        const unsigned long long limit = parse_size( line );
+        if( limit > 0 && limit < ( 1ULL << 60 ) && ( hw.memory_limit == 0 || limit < hw.memory_limit ) )
+            hw.memory_limit = limit;
+    }
+}
+
+
+// Reads the limits of the cgroups of the process and of their ancestors (limits are inherited)
+inline void probe_cgroups( const std::string& root, Hardware& hw )
+{
+    std::ifstream ifs( ( root + "/proc/self/cgroup" ).c_str() );
+    std::string line;
+    while( std::getline( ifs, line ) )
+    {
+        // "<id>:<controllers>:<path>", with id 0 and no controllers for cgroup v2
+        const size_t first = line.find( ':' );
+        const size_t second = first == std::string::npos ? std::string::npos : line.find( ':', first+1 );
+        if( second == std::string::npos )
+            continue;
+
+        const std::string controllers = line.substr( first+1, second-first-1 );
+        std::string path = line.substr( second+1 );
+        const bool v2 = controllers.empty();
+        const std::string list = "," + controllers + ",";
+        const bool cpu = v2 || list.find( ",cpu," ) != std::string::npos;
+        const bool memory = v2 || list.find( ",memory," ) != std::string::npos;
+        if( !cpu && !memory )
+            continue;
+
+        const std::string base = root + "/sys/fs/cgroup" + ( v2 ? "" : "/" + controllers );
+        for( ;; )
+        {
+            read_cgroup_limits( base + path, v2, cpu, memory, hw );
+            const size_t slash = path.find_last_of( '/' );
+            if( path.empty() || slash == std::string::npos )
+                break;
+            path.erase( slash );
+        }
+    }
+}
+
+
+// Reads the L2 and L3 cache sizes of the first CPU
+inline void probe_caches( const std::string& root, Hardware& hw )
+{
+    for( int idx=0; idx<16; ++idx )
+    {
+        std::stringstream dir;
+        dir << root << "/sys/devices/system/cpu/cpu0/cache/index" << idx;
+        std::string level;
+        std::string type;
+        std::string size;
+        if( !read_first_line( dir.str() + "/level", level ) )
+            break;
+        if( !read_first_line( dir.str() + "/type", type ) || type == "Instruction" || !read_first_line( dir.str() + "/size", size ) )
+            continue;
+
+        if( level == "2" )
+            hw.l2_cache = parse_size( size );
+        else if( level == "3" )
+            hw.l3_cache = parse_size( size );
+    }
+}
+#endif
+
+}
+
+
+
+struct ConfigOptions::Registry
+{
+    Registry() : depth( 0 ), flags( 0 ), capacity( 0 ), usage() {}
+
+    ~Registry()
+    {
+        for( size_t i=0; i<flag_chunks.size(); ++i )
+            delete[] flag_chunks[i];
+        for( size_t i=0; i<blocks.size(); ++i )
+            release( blocks[i] );
+        for( size_t i=0; i<retired.size(); ++i )
+            release( retired[i] );
+        for( size_t i=0; i<retired_values.size(); ++i )
+            retired_values[i].release( retired_values[i].bits );
+        for( size_t i=0; i<subscriptions.size(); ++i )
+        {
+#ifdef INCFG_HAS_POSIX_IO
+            if( subscriptions[i]->write_fd != subscriptions[i]->read_fd )
+                ::close( subscriptions[i]->write_fd );
+            ::close( subscriptions[i]->read_fd );
+#endif
+            delete subscriptions[i];
+        }
+    }
+
+    // A block of words holding one replica of the published values
+    struct ReplicaBlock
+    {
+        detail::Word* words;
+        size_t bytes;
+        bool mapped;
+    };
+
+    std::map< std::string, Option* > options;
+
+    // Writer lock, held by publications and registrations
+    std::recursive_mutex mutex;
+    unsigned int depth;
+
+    // Words of the published options, indexed by their slot
+    std::vector< detail::Word* > published;
+
+    // Packed bool options: chunks of FLAG_CHUNK words (never moved, as options point to them), the
+    // number of flags allocated and the slot of each word
+    static const size_t FLAG_CHUNK = 64;
+    std::vector< detail::Word* > flag_chunks;
+    size_t flags;
+    std::vector< size_t > flag_slots;
+
+    // NUMA replicas: the current block of each node (indexed like ConfigOptions::replicas), the node id they
+    // are bound to (-1 if emulated) and the replica index of each cpu. Blocks replaced by a larger one are
+    // retired but kept alive, as readers may still be using them.
+    size_t capacity;
+    std::vector< ReplicaBlock > blocks;
+    std::vector< int > nodes;
+    std::vector< int > cpu_replica;
+    std::vector< ReplicaBlock > retired;
+
+    // Notification descriptors (See ConfigOptions::notification_fd): the descriptor written to (the same
+    // as the read one for an eventfd), the options of interest and the options changed since the last fetch
+    struct Subscription
+    {
+        int read_fd;
+        int write_fd;
+        bool all;
+        std::set< Option* > pending;
+    };
+
+    std::vector< Subscription* > subscriptions;
+    std::map< Option*, std::vector< Subscription* > > subscribers;
+    std::vector< Option* > changed;
+
+    // Functions called at the end of publications changing options (See ConfigOptions::add_listener)
+    std::vector< std::pair< void (*)( void* ), void* > > listeners;
+
+    Subscription* find_subscription( int fd )
+    {
+        for( size_t i=0; i<subscriptions.size(); ++i )
+            if( subscriptions[i]->read_fd == fd )
+                return subscriptions[i];
+        INCFG_THROW( std::invalid_argument("Not a notification descriptor") );
+    }
+
+    // Published values replaced by a new one, with the function releasing them, their heap bytes and the
+    // reclamation epoch they were retired in (See ConfigOptions::reclaim_retired)
+    struct RetiredValue
+    {
+        unsigned long long bits;
+        void (*release)( unsigned long long );
+        size_t bytes;
+        unsigned long long epoch;
+    };
+    std::vector< RetiredValue > retired_values;
+
+    // Memory counters, updated at allocation points (the registry bookkeeping is computed from sizes)
+    MemoryUsage usage;
+
+    static ReplicaBlock allocate( size_t capacity, int node )
+    {
+        ReplicaBlock block;
+        block.bytes = capacity * sizeof( detail::Word );
+        block.mapped = false;
+        block.words = 0;
+
+#ifdef __linux__
+        const size_t page = static_cast< size_t >( sysconf( _SC_PAGESIZE ) );
+        block.bytes = (block.bytes + page - 1) / page * page;
+        void* mem = mmap( 0, block.bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+        if( mem != MAP_FAILED )
+        {
+            if( node >= 0 )
+            {
+                // MPOL_PREFERRED: pages are allocated on the node when possible. Bound before the first touch.
+                unsigned long mask[ INCFG_MAX_NUMA_NODES / (8*sizeof(unsigned long)) + 1 ] = { 0 };
+                mask[ node / (8*sizeof(unsigned long)) ] |= 1UL << (node % (8*sizeof(unsigned long)));
+                syscall( SYS_mbind, mem, block.bytes, 1 /* MPOL_PREFERRED */, mask, sizeof(mask)*8, 0 );
+            }
+            block.words = static_cast< detail::Word* >( mem );
+            block.mapped = true;
+        }
+#else
+        (void)node;
+#endif
+
+        if( !block.words )
+            block.words = static_cast< detail::Word* >( ::operator new( block.bytes ) );
+
+        for( size_t i=0; i<capacity; ++i )
+            new ( block.words + i ) detail::Word( 0 );
+
+        return block;
+    }
+
+
+    static void release( const ReplicaBlock& block )
+    {
+#ifdef __linux__
+        if( block.mapped )
+        {
+            munmap( block.words, block.bytes );
+            return;
+        }
+#endif
+        ::operator delete( block.words );
+    }
+};
+
+
+INCFG_INLINE ConfigOptions::Registry& ConfigOptions::get_registry() const
+{
+    // Constructed on first use (thread-safe), so that the singleton itself can be initialized at compile time.
+    // Options register from their constructors, so the registry is destroyed after them.
+    static Registry reg;
+    return reg;
+}
+
+
+INCFG_INLINE void ConfigOptions::add_option( Option* opt )
+{
+    Registry& reg = get_registry();
+    std::lock_guard< std::recursive_mutex > lock( reg.mutex );
+    if( is_sealed() )
+        INCFG_THROW( std::logic_error("Option " + opt->name + " cannot be registered: the configuration is sealed") );
+
+    std::map< std::string, Option* >& options = reg.options;
+    std::map< std::string, Option* >::iterator it = options.find( opt->name );
+    if( it == options.end() )
+    {
+        options[opt->name] = opt;
+    }
+    else if( it->second->type_id != opt->type_id )
+    {
+        INCFG_THROW( std::logic_error("Option " + opt->name + " is required with different types") );
+    }
+    else if( it->second != opt )
+    {
+        INCFG_THROW( std::logic_error("Option " + opt->name + " is required more than once") );
+    }
+    else
+    {
+        return;
+    }
+
+    reg.usage.keys += 2*detail::heap_bytes( opt->name );
+    reg.usage.options += opt->object_size();
+    reg.usage.descriptions += detail::heap_bytes( opt->description );
+    reg.usage.string_values += opt->value_heap_bytes();
+
+    // bool options share words published by allocate_flag
+    if( opt->word && !opt->is_bool() )
+        opt->slot = publish_word( opt->word );
+}
+
+
+INCFG_INLINE bool ConfigOptions::check_type( const char* name, const void* type_id )
+{
+    Registry& reg = get_registry();
+    std::lock_guard< std::recursive_mutex > lock( reg.mutex );
+    std::map< std::string, Option* >::const_iterator it = reg.options.find( name );
+    if( it != reg.options.end() && it->second->type_id != type_id )
+        INCFG_THROW( std::logic_error("Option " + it->first + " is required with different types") );
+
+    return true;
+}
+
+
+INCFG_INLINE size_t ConfigOptions::publish_word( detail::Word* word )
+{
+    // Called with the writer lock held
+    Registry& reg = get_registry();
+    const size_t slot = reg.published.size();
+    reg.published.push_back( word );
+
+    if( !reg.blocks.empty() )
+    {
+        if( slot >= reg.capacity )
+            grow_replicas( 2*reg.capacity );
+
+        const unsigned long long bits = word->load( std::memory_order_relaxed );
+        for( size_t i=0; i<reg.blocks.size(); ++i )
+            reg.blocks[i].words[ slot ].store( bits, std::memory_order_release );
+    }
+    return slot;
+}
+
+
+INCFG_INLINE detail::Word* ConfigOptions::allocate_flag( bool value, unsigned long long& mask, size_t& slot )
+{
+    Registry& reg = get_registry();
+    std::lock_guard< std::recursive_mutex > lock( reg.mutex );
+    const size_t idx = reg.flags++;
+    const size_t word_idx = idx / 64;
+    mask = 1ULL << ( idx % 64 );
+
+    if( word_idx == reg.flag_chunks.size() * Registry::FLAG_CHUNK )
+    {
+        detail::Word* chunk = new detail::Word[ Registry::FLAG_CHUNK ];
+        for( size_t i=0; i<Registry::FLAG_CHUNK; ++i )
+            chunk[i].store( 0, std::memory_order_relaxed );
+        reg.flag_chunks.push_back( chunk );
+    }
+
+    detail::Word* word = &reg.flag_chunks[ word_idx / Registry::FLAG_CHUNK ][ word_idx % Registry::FLAG_CHUNK ];
+    if( word_idx == reg.flag_slots.size() )
+        reg.flag_slots.push_back( publish_word( word ) );
+    slot = reg.flag_slots[ word_idx ];
+
+    if( value )
+    {
+        const unsigned long long bits = word->load( std::memory_order_relaxed ) | mask;
+        word->store( bits, std::memory_order_release );
+        for( size_t i=0; i<reg.blocks.size(); ++i )
+            reg.blocks[i].words[ slot ].store( bits, std::memory_order_release );
+    }
+    return word;
+}
+
+
+INCFG_INLINE void ConfigOptions::begin_publication()
+{
+    Registry& reg = get_registry();
+    reg.mutex.lock();
+    if( reg.depth++ == 0 )
+    {
+        sequence.store( sequence.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_release );
+    }
+}
+
+
+INCFG_INLINE void ConfigOptions::end_publication()
+{
+    Registry& reg = get_registry();
+    if( --reg.depth == 0 )
+    {
+        sequence.store( sequence.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+
+        if( !reg.retired_values.empty() )
+            reclaim_retired();
+
+        // Notifies the subscribers of the changed options, once until they fetch the changes
+        for( size_t i=0; i<reg.changed.size(); ++i )
+        {
+            Option* opt = reg.changed[i];
+            std::map< Option*, std::vector< Registry::Subscription* > >::iterator it = reg.subscribers.find( opt );
+            for( size_t j=0; j<reg.subscriptions.size(); ++j )
+            {
+                Registry::Subscription* sub = reg.subscriptions[j];
+                if( !sub->all && ( it == reg.subscribers.end() ||
+                                   std::find( it->second.begin(), it->second.end(), sub ) == it->second.end() ) )
+                    continue;
+
+                if( sub->pending.empty() )
+                {
+#ifdef INCFG_HAS_POSIX_IO
+                    const unsigned long long one = 1;
+                    while( ::write( sub->write_fd, &one, sizeof(one) ) < 0 && errno == EINTR ) {}
+#endif
+                }
+                sub->pending.insert( opt );
+            }
+        }
+
+        if( !reg.changed.empty() )
+        {
+            for( size_t i=0; i<reg.listeners.size(); ++i )
+                reg.listeners[i].first( reg.listeners[i].second );
+        }
+        reg.changed.clear();
+    }
+    reg.mutex.unlock();
+}
+
+
+INCFG_INLINE void ConfigOptions::lock_writers()
+{
+    get_registry().mutex.lock();
+}
+
+
+INCFG_INLINE void ConfigOptions::unlock_writers()
+{
+    get_registry().mutex.unlock();
+}
+
+
+INCFG_INLINE void ConfigOptions::seal()
+{
+    Registry& reg = get_registry();
+    std::lock_guard< std::recursive_mutex > lock( reg.mutex );
+    sealed.store( true, std::memory_order_release );
+}
+
+
+INCFG_INLINE void ConfigOptions::seal( std::initializer_list< const char* > keys )
+{
+    Registry& reg = get_registry();
+    std::lock_guard< std::recursive_mutex > lock( reg.mutex );
+
+    // All the keys are checked first, so that nothing is sealed if one does not exist
+    for( std::initializer_list< const char* >::const_iterator it=keys.begin(); it!=keys.end(); ++it )
+        if( !get( *it ) )
+            INCFG_THROW( std::invalid_argument( std::string("Unexpected key: ") + *it ) );
+
+    for( std::initializer_list< const char* >::const_iterator it=keys.begin(); it!=keys.end(); ++it )
+        get( *it )->sealed = true;
+}
+
+
+INCFG_INLINE void ConfigOptions::changed( Option& opt )
+{
+    Registry& reg = get_registry();
+    if( !reg.subscriptions.empty() || !reg.listeners.empty() )
+        reg.changed.push_back( &opt );
+}
+
+
+INCFG_INLINE void ConfigOptions::add_listener( void (*listener)( void* ), void* context )
+{
+    Registry& reg = get_registry();
+    std::lock_guard< std::recursive_mutex > lock( reg.mutex );
+    reg.listeners.push_back( std::make_pair( listener, context ) );
+}
+
+
+INCFG_INLINE void ConfigOptions::remove_listener( void (*listener)( void* ), void* context )
+{
+    Registry& reg = get_registry();
+    std::lock_guard< std::recursive_mutex > lock( reg.mutex );
+    reg.listeners.erase( std::remove( reg.listeners.begin(), reg.listeners.end(), std::make_pair( listener, context ) ), reg.listeners.end() );
+}
+
+
+INCFG_INLINE int ConfigOptions::notification_fd( std::initializer_list< const char* > keys )
+{
+#ifdef INCFG_HAS_POSIX_IO
+    Registry& reg = get_registry();
+    std::lock_guard< std::recursive_mutex > lock( reg.mutex );
+
+    std::vector< Option* > opts;
+    for( std::initializer_list< const char* >::const_iterator it=keys.begin(); it!=keys.end(); ++it )
+    {
+        Option* opt = get( *it );
+        if( !opt )
+            INCFG_THROW( std::invalid_argument( std::string("Unexpected key: ") + *it ) );
+        opts.push_back( opt );
+    }
+
+    Registry::Subscription* sub = new Registry::Subscription;
+    sub->all = opts.empty();
+#ifdef __linux__
+    sub->read_fd = sub->write_fd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+    const bool ok = sub->read_fd >= 0;
+#else
+    int fds[2];
+    const bool ok = pipe( fds ) == 0;
+    if( ok )
+    {
+        for( int i=0; i<2; ++i )
+        {
+            fcntl( fds[i], F_SETFL, fcntl( fds[i], F_GETFL ) | O_NONBLOCK );
+            fcntl( fds[i], F_SETFD, FD_CLOEXEC );
+        }
+        sub->read_fd = fds[0];
+        sub->write_fd = fds[1];
+    }
+#endif
+    if( !ok )
+    {
+        delete sub;
+        INCFG_THROW( std::runtime_error( std::string("Unable to create a notification descriptor: ") + std::strerror( errno ) ) );
+    }
+
+    reg.subscriptions.push_back( sub );
+    for( size_t i=0; i<opts.size(); ++i )
+        reg.subscribers[ opts[i] ].push_back( sub );
+    return sub->read_fd;
+#else
+    (void)keys;
+    INCFG_THROW( std::runtime_error("Notification descriptors are not supported on this platform") );
+#endif
+}
+
+
+INCFG_INLINE void ConfigOptions::close_notification_fd( int fd )
+{
+    Registry& reg = get_registry();
+    std::lock_guard< std::recursive_mutex > lock( reg.mutex );
+    Registry::Subscription* sub = reg.find_subscription( fd );
+
+    reg.subscriptions.erase( std::find( reg.subscriptions.begin(), reg.subscriptions.end(), sub ) );
+    for( std::map< Option*, std::vector< Registry::Subscription* > >::iterator it=reg.subscribers.begin(); it!=reg.subscribers.end(); )
+    {
+        it->second.erase( std::remove( it->second.begin(), it->second.end(), sub ), it->second.end() );
+        if( it->second.empty() )
+            reg.subscribers.erase( it++ );
+        else
+            ++it;
+    }
+
+#ifdef INCFG_HAS_POSIX_IO
+    if( sub->write_fd != sub->read_fd )
+        ::close( sub->write_fd );
+    ::close( sub->read_fd );
+#endif
+    delete sub;
+}
+
+
+INCFG_INLINE size_t ConfigOptions::fetch_changes( int fd, void (*visit)( Option&, void* ), void* visitor )
 {
-    static ConfigOptions co;
-    return co;
+    std::vector< Option* > changes;
+    {
+        Registry& reg = get_registry();
+        std::lock_guard< std::recursive_mutex > lock( reg.mutex );
+        Registry::Subscription* sub = reg.find_subscription( fd );
+
+#ifdef INCFG_HAS_POSIX_IO
+        // Rearms the descriptor (an eventfd is reset by a single read)
+        unsigned long long count;
+        for( ;; )
+        {
+            const ssize_t len = ::read( sub->read_fd, &count, sizeof(count) );
+            if( len > 0 || ( len < 0 && errno == EINTR ) )
+                continue;
+            break;
+        }
+#endif
+        changes.assign( sub->pending.begin(), sub->pending.end() );
+        sub->pending.clear();
+    }
+
+    // Outside of the lock, so that the visitor can read or set options
+    for( size_t i=0; i<changes.size(); ++i )
+        visit( *changes[i], visitor );
+
+    return changes.size();
 }
 
 
-void ConfigOptions::load( int argc, char* argv[] )
+INCFG_INLINE void ConfigOptions::store_published( Option& opt, unsigned long long bits )
 {
-    if( argc<2 )
+    // Release stores: the bits may point to a value (eg. a std::string copy) readers dereference
+    Registry& reg = get_registry();
+    opt.word->store( bits, std::memory_order_release );
+    for( size_t i=0; i<reg.blocks.size(); ++i )
+        reg.blocks[i].words[ opt.slot ].store( bits, std::memory_order_release );
+}
+
+
+INCFG_INLINE void ConfigOptions::retire_published( unsigned long long bits, void (*release)( unsigned long long ), size_t bytes )
+{
+    Registry& reg = get_registry();
+    const Registry::RetiredValue retired = { bits, release, bytes, reclaim_epoch.load( std::memory_order_relaxed ) };
+    reg.retired_values.push_back( retired );
+    reg.usage.history += bytes;
+}
+
+
+INCFG_INLINE void ConfigOptions::reclaim_retired()
+{
+    // Called at the end of a publication, with the writer lock held. The new values are stored: readers
+    // pinned to a later epoch, or pinned after the fence, can only reference them. Locked readers are
+    // excluded by the lock, except the calling thread itself: its values are freed by a later publication.
+    Registry& reg = get_registry();
+    const unsigned long long epoch = reclaim_epoch.fetch_add( 1, std::memory_order_seq_cst ) + 1;
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    if( reader_locked )
         return;
 
+    // Values retired before the oldest epoch a reader is pinned to can no longer be referenced
+    unsigned long long oldest = epoch;
+    const size_t used = readers_used.load( std::memory_order_seq_cst );
+    for( size_t i=0; i<used; ++i )
+    {
+        const unsigned long long state = readers[i].state.load( std::memory_order_acquire );
+        if( state >= SLOT_PINNED )
+            oldest = std::min( oldest, state - SLOT_PINNED );
+    }
+
+    // Values are retired in epoch order: the freed ones are a prefix
+    size_t freed = 0;
+    while( freed < reg.retired_values.size() && reg.retired_values[ freed ].epoch < oldest )
+    {
+        reg.retired_values[ freed ].release( reg.retired_values[ freed ].bits );
+        reg.usage.history -= reg.retired_values[ freed ].bytes;
+        ++freed;
+    }
+    reg.retired_values.erase( reg.retired_values.begin(), reg.retired_values.begin() + freed );
+}
+
+
+INCFG_INLINE std::atomic< unsigned long long >* ConfigOptions::register_reader()
+{
+    // Releases the slot when the thread exits (the registration of the destructor may allocate, once per thread)
+    struct Registration
+    {
+        ~Registration()
+        {
+            if( reader_slot )
+                reader_slot->store( 0, std::memory_order_release );
+            reader_slot = 0;
+            reader_pinned = false;
+        }
+    };
+    thread_local Registration registration;
+    (void)registration;
+
+    for( size_t i=0; i<INCFG_MAX_READER_THREADS; ++i )
+    {
+        unsigned long long expected = 0;
+        if( readers[i].state.compare_exchange_strong( expected, SLOT_IDLE, std::memory_order_relaxed ) )
+        {
+            // Writers scan the slots up to the highest one ever claimed
+            size_t used = readers_used.load( std::memory_order_relaxed );
+            while( used < i+1 && !readers_used.compare_exchange_weak( used, i+1, std::memory_order_seq_cst ) ) {}
+            reader_slot = &readers[i].state;
+            return reader_slot;
+        }
+    }
+
+    // No free slot: the thread holds the writer lock during its read sections, until a slot is released
+    return 0;
+}
+
+
+INCFG_INLINE void ConfigOptions::grow_replicas( size_t capacity )
+{
+    // Called with the writer lock held
+    Registry& reg = get_registry();
+    for( size_t i=0; i<reg.blocks.size(); ++i )
+    {
+        Registry::ReplicaBlock block = Registry::allocate( capacity, reg.nodes[i] );
+        for( size_t slot=0; slot<reg.published.size(); ++slot )
+            block.words[ slot ].store( reg.published[ slot ]->load( std::memory_order_relaxed ), std::memory_order_relaxed );
+
+        replicas[i].store( block.words, std::memory_order_release );
+        reg.usage.snapshots += block.bytes - reg.blocks[i].bytes;
+        reg.usage.history += reg.blocks[i].bytes;
+        reg.retired.push_back( reg.blocks[i] );
+        reg.blocks[i] = block;
+    }
+    reg.capacity = capacity;
+}
+
+
+INCFG_INLINE void ConfigOptions::enable_numa_replicas( unsigned int emulated_nodes )
+{
+    Registry& reg = get_registry();
+    std::lock_guard< std::recursive_mutex > lock( reg.mutex );
+    if( !reg.blocks.empty() )
+        INCFG_THROW( std::logic_error("NUMA replicas are already enabled") );
+
+    std::vector< int > nodes;
+    std::vector< int > cpu_replica;
+    if( emulated_nodes > 0 )
+    {
+        if( emulated_nodes > INCFG_MAX_NUMA_NODES )
+            INCFG_THROW( std::invalid_argument("Too many NUMA nodes (See INCFG_MAX_NUMA_NODES)") );
+
+        long cpus = 1;
+#ifdef __linux__
+        cpus = std::max( sysconf( _SC_NPROCESSORS_CONF ), 1L );
+#endif
+        nodes.assign( emulated_nodes, -1 );
+        for( long cpu=0; cpu<cpus; ++cpu )
+            cpu_replica.push_back( static_cast< int >( cpu * emulated_nodes / cpus ) );
+    }
+    else
+    {
+#ifdef __linux__
+        const std::vector< int > online = detail::parse_id_list( "/sys/devices/system/node/online" );
+        for( size_t i=0; i<online.size() && nodes.size()<INCFG_MAX_NUMA_NODES; ++i )
+        {
+            std::stringstream path;
+            path << "/sys/devices/system/node/node" << online[i] << "/cpulist";
+            const std::vector< int > cpus = detail::parse_id_list( path.str() );
+            for( size_t j=0; j<cpus.size(); ++j )
+            {
+                if( static_cast< size_t >( cpus[j] ) >= cpu_replica.size() )
+                    cpu_replica.resize( cpus[j]+1, 0 );
+                cpu_replica[ cpus[j] ] = static_cast< int >( nodes.size() );
+            }
+            nodes.push_back( online[i] );
+        }
+#endif
+        // Nothing to gain from a single replica
+        if( nodes.size() < 2 )
+            return;
+    }
+
+    reg.nodes = nodes;
+    reg.cpu_replica = cpu_replica;
+    reg.capacity = std::max< size_t >( 512, reg.published.size() );
+    for( size_t i=0; i<nodes.size(); ++i )
+    {
+        Registry::ReplicaBlock block = Registry::allocate( reg.capacity, nodes[i] );
+        for( size_t slot=0; slot<reg.published.size(); ++slot )
+            block.words[ slot ].store( reg.published[ slot ]->load( std::memory_order_relaxed ), std::memory_order_relaxed );
+
+        reg.blocks.push_back( block );
+        reg.usage.snapshots += block.bytes;
+        replicas[i].store( block.words, std::memory_order_release );
+    }
+    numa_enabled.store( true, std::memory_order_release );
+}
+
+
+INCFG_INLINE void ConfigOptions::account_value_bytes( size_t old_bytes, size_t new_bytes )
+{
+    MemoryUsage& usage = get_registry().usage;
+    usage.string_values = usage.string_values - old_bytes + new_bytes;
+}
+
+
+INCFG_INLINE MemoryUsage ConfigOptions::memory_usage() const
+{
+    // Estimated size of a std::map node: the tree links and color, and the key-value pair
+    static const size_t map_node_size = 4*sizeof( void* ) + sizeof( std::map< std::string, Option* >::value_type );
+
+    Registry& reg = get_registry();
+    std::lock_guard< std::recursive_mutex > lock( reg.mutex );
+    MemoryUsage usage = reg.usage;
+    usage.registry = sizeof( Registry ) + reg.options.size() * map_node_size +
+                     reg.published.capacity() * sizeof( detail::Word* ) +
+                     reg.flag_chunks.size() * Registry::FLAG_CHUNK * sizeof( detail::Word ) +
+                     reg.flag_chunks.capacity() * sizeof( detail::Word* ) + reg.flag_slots.capacity() * sizeof( size_t ) +
+                     (reg.blocks.capacity() + reg.retired.capacity()) * sizeof( Registry::ReplicaBlock ) +
+                     reg.retired_values.capacity() * sizeof( Registry::RetiredValue ) +
+                     (reg.nodes.capacity() + reg.cpu_replica.capacity()) * sizeof( int );
+    return usage;
+}
+
+
+INCFG_INLINE unsigned int ConfigOptions::numa_replicas() const
+{
+    Registry& reg = get_registry();
+    std::lock_guard< std::recursive_mutex > lock( reg.mutex );
+    return static_cast< unsigned int >( reg.blocks.size() );
+}
+
+
+INCFG_INLINE Hardware probe_hardware( const std::string& root )
+{
+    Hardware hw = Hardware();
+#ifdef INCFG_HAS_POSIX_IO
+    hw.online_cpus = static_cast< unsigned int >( std::max( sysconf( _SC_NPROCESSORS_ONLN ), 1L ) );
+    hw.page_size = static_cast< unsigned long long >( std::max( sysconf( _SC_PAGESIZE ), 1L ) );
+#ifdef _SC_PHYS_PAGES
+    hw.memory = static_cast< unsigned long long >( std::max( sysconf( _SC_PHYS_PAGES ), 0L ) ) * hw.page_size;
+#endif
+#else
+    hw.online_cpus = 1;
+#endif
+
+#ifdef __linux__
+    cpu_set_t set;
+    if( sched_getaffinity( 0, sizeof( set ), &set ) == 0 )
+        hw.available_cpus = static_cast< unsigned int >( CPU_COUNT( &set ) );
+
+    detail::probe_cgroups( root, hw );
+    detail::probe_caches( root, hw );
+#else
+    (void)root;
+#endif
+    return hw;
+}
+
+
+INCFG_INLINE const Hardware& hardware()
+{
+    static const Hardware hw = probe_hardware( "" );
+    return hw;
+}
+
+
+INCFG_INLINE void ConfigOptions::refresh_thread_node()
+{
+    thread_node = -1;
+}
+
+
+INCFG_INLINE int ConfigOptions::lookup_thread_node() const
+{
+    // cpu_replica is only written before replicas are enabled
+    if( !numa_enabled.load( std::memory_order_acquire ) )
+        return 0;
+
+    const std::vector< int >& cpu_replica = get_registry().cpu_replica;
+    int cpu = 0;
+#ifdef __linux__
+    cpu = sched_getcpu();
+#endif
+    if( cpu < 0 || static_cast< size_t >( cpu ) >= cpu_replica.size() )
+        return 0;
+
+    return cpu_replica[ cpu ];
+}
+
+
+INCFG_INLINE Option* ConfigOptions::get( const std::string& name ) const
+{
+    const std::map< std::string, Option* >& options = get_registry().options;
+    std::map< std::string, Option* >::const_iterator it = options.find( name );
+    return it != options.end() ? it->second : 0;
+}
+
+
+INCFG_INLINE std::string ConfigOptions::to_config_string() const
+{
+    const std::map< std::string, Option* >& options = get_registry().options;
+    std::stringstream ss;
+    //ss << "# Generated config file" << std::endl;
+    for( std::map< std::string, Option*>::const_iterator it=options.begin(); it!=options.end(); ++it )
+    {
+        if( it->second->description.length() > 0 )
+        {
+            ss << "# " << it->second->description << std::endl;
+            ss << "# " << std::endl;
+        }
+        ss << (it->second->is_default()?"#":"") << it->first <<  "=" << it->second->get_value_as_str() << std::endl << std::endl;
+    }
+    return ss.str();
+}
+
+
+INCFG_INLINE size_t ConfigOptions::size() const
+{
+    return get_registry().options.size();
+}
+
+
+INCFG_INLINE Option* ConfigOptions::option_by_index( size_t idx ) const
+{
+    const std::map< std::string, Option* >& options = get_registry().options;
+    std::map< std::string, Option* >::const_iterator it = options.begin();
+
+    while( idx>0 && it!=options.end() )
+    {
+        ++it;
+        --idx;
+    }
+
+    if( it!=options.end() )
+    {
+        return it->second;
+    }
+
+    return 0;
+}
+
+
+INCFG_INLINE void Status::raise_error() const
+{
+    if( code == Errc::invalid_value )
+        INCFG_THROW( StringParseException( text ) );
+
+    if( code == Errc::sealed )
+        INCFG_THROW( std::logic_error( text ) );
+
+    INCFG_THROW( ConfigOptionsLoadException( text ) );
+}
+
+
+INCFG_INLINE void ConfigOptions::load( int argc, char* argv[] )
+{
+    try_load( argc, argv ).raise();
+}
+
+
+INCFG_INLINE Status ConfigOptions::try_load( int argc, char* argv[] )
+{
+    std::map< std::string, Option* >& options = get_registry().options;
+    if( argc<2 )
+        return Status();
+
+    // The values are staged and published as a single version once all the arguments are parsed
+    Batch batch;
     for( size_t idx=1; idx<static_cast<size_t>(argc); idx++ )
     {
         std::string key( argv[idx] );
         //std::cout << "KEY: <" << key << ">" << std::endl;
         if( key.length()<3 )
-            throw ConfigOptionsLoadException("Invalid configuration option: "+key);
+            return Status( Errc::syntax_error, idx, "Invalid configuration option: "+key );
 
         if( key[0]!='-' && key[1]!='-' )
-            throw ConfigOptionsLoadException("Invalid configuration option: "+key);
+            return Status( Errc::syntax_error, idx, "Invalid configuration option: "+key );
 
         key = key.substr(2,key.length()-1);
 
-        if( options.find(key) == options.end() )
+        std::map< std::string, Option* >::iterator it = options.find( key );
+        if( it == options.end() )
         {
-            throw ConfigOptionsLoadException("Unexpected key: " + key );
+            return Status( Errc::unknown_key, idx, "Unexpected key: " + key );
         }
 
-
-        if( options[key]->is_bool() )
+        Status status;
+        if( it->second->is_bool() )
         {
-            options[key]->parse_value_from_str( std::string("true") );
+            status = it->second->try_stage_value_from_str( std::string("true"), batch );
         }
         else
         {
-            if( idx==argc )
-                throw ConfigOptionsLoadException("A value is expected for configuration option " + key );
+            if( idx+1==static_cast<size_t>(argc) )
+                return Status( Errc::missing_value, idx, "A value is expected for configuration option " + key );
 
             std::string value( argv[++idx] );
 
             if( value.length()>1 && value[0]=='-' && value[1]=='-' )
-                throw ConfigOptionsLoadException( value + " is an invalid value for key " + key );
+                return Status( Errc::missing_value, idx, value + " is an invalid value for key " + key );
 
             //std::cout << "VALUE: <" << value << ">" << std::endl;
-            options[key]->parse_value_from_str( value );
+            status = it->second->try_stage_value_from_str( value, batch );
+        }
+
+        if( !status )
+        {
+            status.line = idx;
+            return status;
         }
     }
+    return batch.try_commit();
+}
+
+
+INCFG_INLINE void ConfigOptions::load( std::istream& _isr)
+{
+    try_load( _isr ).raise();
 }
 
 
-void ConfigOptions::load( std::istream& _isr)
+INCFG_INLINE Status ConfigOptions::try_load( std::istream& _isr )
 {
     if( _isr.fail() )
     {
-        throw ConfigOptionsLoadException("IO Error.");
+        return Status( Errc::io_error, 0, "IO Error." );
+    }
+
+    Parser parser( *this );
+    char block[ 1 << 16 ];
+    while( _isr.read( block, sizeof(block) ) || _isr.gcount() > 0 )
+    {
+        const Status status = parser.try_feed( block, static_cast< size_t >( _isr.gcount() ) );
+        if( !status )
+            return status;
     }
+    return parser.try_finish();
+}
+
+
+INCFG_INLINE void ConfigOptions::load_fd( int fd, size_t max_line_length )
+{
+    try_load_fd( fd, max_line_length ).raise();
+}
 
-    unsigned int linenum=0;
-    std::string buff;
-    std::getline( _isr, buff );
 
-    while( !_isr.eof() || !_isr.fail() )
+INCFG_INLINE Status ConfigOptions::try_load_fd( int fd, size_t max_line_length )
+{
+#ifdef INCFG_HAS_POSIX_IO
+    Parser parser( *this, max_line_length );
+    char block[ 1 << 16 ];
+    for( ;; )
     {
-        if( buff[0] == '#' || buff[0]==0  || buff[0]=='\n' || buff[0]=='\r' )
+        const ssize_t len = ::read( fd, block, sizeof(block) );
+        if( len == 0 )
+            break;
+
+        if( len < 0 )
         {
-            std::getline( _isr, buff );linenum++;
-            continue;
+            if( errno == EINTR )
+                continue;
+            return Status( Errc::io_error, parser.lines(), std::string("IO Error: ") + std::strerror( errno ) );
         }
 
-        // Remove all spaces before and after a "
-        size_t end_idx = buff.find_first_of("\"");
-        if( end_idx == std::string::npos )
-            end_idx = buff.length();
-        buff.erase(std::remove( buff.begin(), buff.begin()+end_idx, ' '), buff.begin()+end_idx );
-        size_t start_idx = buff.find_last_of("\"");
-        if( start_idx == std::string::npos )
-            start_idx = 0;
-        buff.erase(std::remove( buff.begin()+start_idx, buff.end(), ' '), buff.end() );
+        const Status status = parser.try_feed( block, static_cast< size_t >( len ) );
+        if( !status )
+            return status;
+    }
+    return parser.try_finish();
+#else
+    (void)fd;
+    (void)max_line_length;
+    return Status( Errc::io_error, 0, "Loading from a file descriptor is not supported on this platform" );
+#endif
+}
+
+
+struct Batch::Index
+{
+    std::map< const Option*, Staged* > staged;
+};
+
+
+INCFG_INLINE Batch::Staged*& Batch::staged_value( const Option& opt )
+{
+    if( !index )
+        index = new Index();
+    return index->staged[ &opt ];
+}
+
+
+INCFG_INLINE void Batch::clear()
+{
+    while( first )
+    {
+        Staged* next = first->next;
+        delete first;
+        first = next;
+    }
+    last = 0;
+    count = 0;
+    delete index;
+    index = 0;
+}
 
 
-        buff.erase(std::remove( buff.begin()+start_idx, buff.end(), '\r'), buff.end() );
+INCFG_INLINE Parser::Parser( ConfigOptions& _co, size_t _max_line_length )
+    : co( _co ), max_line_length( _max_line_length ), linenum( 0 )
+{
+}
 
 
-        size_t eq_idx = buff.find_first_of('=');
+INCFG_INLINE Status Parser::try_feed( const char* data, size_t len )
+{
+    const char* const end = data + len;
+    while( data != end )
+    {
+        const char* newline = static_cast< const char* >( std::memchr( data, '\n', end-data ) );
+        const char* line_end = newline ? newline : end;
 
-        if( eq_idx == std::string::npos || eq_idx==0 )
+        if( max_line_length && partial.length() + (line_end-data) > max_line_length )
         {
+            batch.clear();
             std::stringstream err;
-            err << "Parse error at line " << linenum << ": No key found (<key> = <value> expected)";
-            throw ConfigOptionsLoadException(err.str());
+            err << "Parse error at line " << linenum+1 << ": line longer than " << max_line_length << " bytes";
+            return Status( Errc::line_too_long, linenum+1, err.str() );
         }
 
-        std::string key = buff.substr(0,eq_idx);
-        std::string value = buff.substr(eq_idx+1, buff.length() );
-
-        //std::cout << "READ: <" << key << "> = <" << value << ">" << std::endl;
+        if( !newline )
+        {
+            partial.append( data, end );
+            return Status();
+        }
 
-        try
+        Status status;
+        if( partial.empty() )
+        {
+            status = parse_line( data, newline );
+        }
+        else
+        {
+            partial.append( data, newline );
+            status = parse_line( partial.data(), partial.data() + partial.length() );
+            partial.clear();
+        }
+        if( !status )
         {
-            add_if_possible( key, value );
+            batch.clear();
+            return status;
+        }
+
+        data = newline+1;
+    }
+    return Status();
+}
 
-        } catch( StringParseException& ex )
+
+INCFG_INLINE Status Parser::try_finish()
+{
+    if( !partial.empty() )
+    {
+        const Status status = parse_line( partial.data(), partial.data() + partial.length() );
+        partial.clear();
+        if( !status )
         {
-            std::stringstream errstr;
-            errstr << "Config file error for key <" << key << "> (Line " << linenum-1 << "): " << ex.what();
-            throw StringParseException( errstr.str() );
+            batch.clear();
+            return status;
         }
+    }
+
+    // All the values of the input are published as a single version
+    Status status = batch.try_commit();
+    status.line = status ? 0 : linenum;
+    linenum = 0;
+    return status;
+}
+
+
+INCFG_INLINE Status Parser::parse_line( const char* begin, const char* end )
+{
+    ++linenum;
+
+    // The value buffer is kept across lines to avoid reallocations
+    detail::LineTokens tok;
+    tok.value.swap( value );
+    const bool assignment = detail::tokenize_line( begin, end, tok );
+    tok.value.swap( value );
+    if( !assignment )
+        return Status();
+
+    if( tok.error )
+    {
+        std::stringstream err;
+        err << "Parse error at line " << linenum << ": " << tok.error;
+        return Status( Errc::syntax_error, linenum, err.str() );
+    }
+
+    const std::string key( tok.key_begin, tok.key_end );
+    Option* opt = co.get( key );
+    if( !opt )
+    {
+        return Status( Errc::unknown_key, linenum, "Unexpected key: " + key );
+    }
+
+    Status status = opt->try_stage_value_from_str( value, batch );
+    status.line = status ? 0 : linenum;
+    if( status.code == Errc::invalid_value )
+    {
+        std::stringstream errstr;
+        errstr << "Config file error for key <" << key << "> (Line " << linenum << "): " << status.text;
+        status.text = errstr.str();
+    }
+    return status;
+}
 
-        std::getline( _isr, buff );linenum++;
+
+INCFG_INLINE void ConfigOptions::load( std::string& _str )
+{
+    try_load( _str ).raise();
+}
+
+
+INCFG_INLINE Status ConfigOptions::try_load( const std::string& _str )
+{
+    // The input is already in memory: its lines are not bounded
+    Parser parser( *this, 0 );
+    const Status status = parser.try_feed( _str.data(), _str.length() );
+    if( !status )
+        return status;
+
+    return parser.try_finish();
+}
+
+
+INCFG_INLINE void ConfigOptions::to_json( Sink& out ) const
+{
+    const std::map< std::string, Option* >& options = get_registry().options;
+    detail::JsonWriter writer( out );
+    out.write( "{", 1 );
+    for( std::map< std::string, Option*>::const_iterator it=options.begin(); it!=options.end(); ++it )
+    {
+        if( it!=options.begin() )
+            out.write( ",", 1 );
+
+        writer.write_string( it->first.data(), it->first.length() );
+        out.write( ":", 1 );
+        it->second->write_value( writer );
+    }
+    out.write( "}", 1 );
+}
+
+
+INCFG_INLINE std::string ConfigOptions::to_json() const
+{
+    std::string str;
+    StringSink sink( str );
+    to_json( sink );
+    return str;
+}
+
+
+INCFG_INLINE void ConfigOptions::to_binary( Sink& out ) const
+{
+    const std::map< std::string, Option* >& options = get_registry().options;
+    for( std::map< std::string, Option*>::const_iterator it=options.begin(); it!=options.end(); ++it )
+        if( it->first.length() > 0xFFFF )
+            INCFG_THROW( std::length_error("Key " + it->first.substr( 0, 32 ) + "... too long for the binary format (65535 bytes at most)") );
+
+    detail::BinaryWriter writer( out );
+    out.write( "INCFGB", 6 );
+    writer.write_u8( 1 );
+    writer.write_le( options.size(), 4 );
+    for( std::map< std::string, Option*>::const_iterator it=options.begin(); it!=options.end(); ++it )
+    {
+        writer.write_le( it->first.length(), 2 );
+        out.write( it->first.data(), it->first.length() );
+        writer.write_u8( it->second->is_default() ? 1 : 0 );
+        it->second->write_value( writer );
     }
 }
 
 
-void ConfigOptions::load( std::string& _str )
+INCFG_INLINE std::string ConfigOptions::to_binary() const
 {
-    std::istringstream ss(_str );
-    load( ss );
+    std::string str;
+    StringSink sink( str );
+    to_binary( sink );
+    return str;
 }
 
 
-void ConfigOptions::add_if_possible( const std::string& key, const std::string& value )
+
+INCFG_INLINE void ConfigOptions::to_frozen_header( Sink& out ) const
 {
-    if( options.find(key) == options.end() )
+    const std::map< std::string, Option* >& options = get_registry().options;
+    detail::CppLiteralWriter writer( out );
+
+    detail::write_str( out, "// Option values frozen at compile time, generated by incfg::ConfigOptions::to_frozen_header()\n"
+                    "//\n"
+                    "// Build with -DINCFG_FROZEN_CONFIG='\"<path of this header>\"' to use it.\n"
+                    "\n"
+                    "#ifndef INCFG_FROZEN_CONFIG_HPP\n"
+                    "#define INCFG_FROZEN_CONFIG_HPP\n"
+                    "\n"
+                    "#include <limits>\n"
+                    "\n" );
+
+    for( std::map< std::string, Option*>::const_iterator it=options.begin(); it!=options.end(); ++it )
     {
-        throw ConfigOptionsLoadException("Unexpected key: " + key );
+        const char* type = it->second->type_name();
+        if( !type )
+            continue;
+
+        detail::write_str( out, "\nstruct incfg_" );
+        detail::write_str( out, it->first.c_str() );
+        detail::write_str( out, "_Tag;\n\n"
+                        "template < >\n"
+                        "struct incfg::Frozen< incfg_" );
+        detail::write_str( out, it->first.c_str() );
+        detail::write_str( out, "_Tag >\n"
+                        "{\n"
+                        "    static constexpr bool value = true;\n"
+                        "    static constexpr " );
+        detail::write_str( out, type );
+        detail::write_str( out, " frozen_value = " );
+        it->second->write_value( writer );
+        detail::write_str( out, ";\n"
+                        "};\n" );
     }
 
-    options[key]->parse_value_from_str( value );
+    detail::write_str( out, "\n#endif\n" );
 }
 
+
+INCFG_INLINE std::string ConfigOptions::to_frozen_header() const
+{
+    std::string str;
+    StringSink sink( str );
+    to_frozen_header( sink );
+    return str;
 }
 
+}
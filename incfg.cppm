@@ -0,0 +1,100 @@
+/*!
+    incfg C++20 module interface (See incfg.hpp for description/usage)
+--------------------------------------------------------------------------------
+
+The MIT License
+Copyright (c) 2015 Filippo Bergamasco
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+module;
+
+#include "incfg.hpp"
+#include "incfg_units.hpp"
+#include "incfg_tuner.hpp"
+
+export module incfg;
+
+
+/*
+ * Options are declared without macros via incfg::Required:
+ *
+ *   import incfg;
+ *
+ *   inline incfg::Required< "BUFFER_SIZE", unsigned int > BUFFER_SIZE( 4096, "Buffer size used to write the log file" );
+ *
+ * The definitions are provided by the incfg library, which must be linked as usual.
+ */
+export namespace incfg
+{
+    using incfg::StringParseException;
+    using incfg::ConfigOptionsLoadException;
+    using incfg::FailHandler;
+    using incfg::set_fail_handler;
+    using incfg::fail;
+    using incfg::Errc;
+    using incfg::Status;
+    using incfg::Unexpected;
+    using incfg::Expected;
+
+    using incfg::to_string_helper;
+    using incfg::from_string_helper;
+    using incfg::parse_value;
+    using incfg::write_value;
+    using incfg::is_boolean;
+
+    using incfg::Sink;
+    using incfg::StringSink;
+    using incfg::ByteSize;
+    using incfg::ValueWriter;
+
+    using incfg::Option;
+    using incfg::MemoryUsage;
+    using incfg::Hardware;
+    using incfg::hardware;
+    using incfg::probe_hardware;
+    using incfg::ConfigOptions;
+    using incfg::Parser;
+    using incfg::TypedOption;
+    using incfg::FixedString;
+    using incfg::Required;
+    using incfg::OptionRef;
+    using incfg::option_ref;
+    using incfg::get_consistent;
+    using incfg::Binding;
+    using incfg::BoundStruct;
+    using incfg::refresh;
+    using incfg::TunerPolicy;
+    using incfg::linear_policy;
+    using incfg::geometric_policy;
+    using incfg::TunerAction;
+    using incfg::Tuner;
+    using incfg::FlagSet;
+    using incfg::flags;
+    using incfg::Batch;
+    using incfg::Multiversion;
+    using incfg::multiversion;
+    using incfg::EnumNames;
+    using incfg::enum_name;
+    using incfg::enum_parse;
+    using incfg::enum_from_string;
+    using incfg::enum_to_string;
+}
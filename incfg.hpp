@@ -21,6 +21,9 @@ keyN = valueN
 
 or via classic ```argv, argc``` command-line string arrays.
 
+Lines starting with ```#``` are comments and whitespace around keys and values is ignored. Values can be
+quoted (```key = "a value"```), in which case the escapes ```\"```, ```\\```, ```\n```, ```\r``` and ```\t``` are decoded.
+
 Type conversion (from a type ```T``` to/from ```std::string```) is handled automatically via ```std::stringstream```
 or can be extended easily for custom types.
 
@@ -150,6 +153,21 @@ int main()
 }
 ```
 
+The ```try_load()``` variants (and ```Parser::try_feed()```/```try_finish()```) report errors as an
+```incfg::Status``` instead of throwing: an ```incfg::Errc``` code, the line (or ```argv``` index) and the
+message the exception would carry.
+
+```
+incfg::Status status = incfg::ConfigOptions::instance().try_load( ifs );
+if( !status )
+    std::cerr << "config line " << status.line << ": " << status.message() << std::endl;
+```
+
+When exceptions are disabled (eg. ```-fno-exceptions```) incfg builds in an exception-free mode
+(```INCFG_NO_EXCEPTIONS```): the ```try_``` functions must then be used, and the errors that only the
+throwing API can report (eg. an option required twice) call the fail handler set with
+```incfg::set_fail_handler()``` before aborting.
+
 ## Loading configuration options from command-line
 
 Configuration options can be loaded from command-line by passing the command line
@@ -177,10 +195,317 @@ $ yourprogramname --BUFFER_SIZE 1024 --DEBUG_LOG --LOGFILENAME test.txt
 ```
 
 
+## Durations and sizes
+
+```incfg_units.hpp``` adds support for ```std::chrono``` durations and for ```incfg::ByteSize```, whose
+values are written with their unit and parsed without iostreams:
+
+```
+#include "incfg_units.hpp"
+
+INCFG_REQUIRE( std::chrono::milliseconds, CONNECT_TIMEOUT, std::chrono::milliseconds(250), "Connection timeout" )
+INCFG_REQUIRE( incfg::ByteSize, BUFFER_SIZE, incfg::ByteSize(4096), "Buffer size" )
+```
+
+```
+CONNECT_TIMEOUT=1.5s
+BUFFER_SIZE=4MiB
+```
+
+When a configuration string is generated, the values are written with the largest unit
+that represents them exactly (```#CONNECT_TIMEOUT=250ms```, ```#BUFFER_SIZE=4KiB```).
+See ```incfg_units.hpp``` for the list of units.
+
+
+## Hardware-aware defaults
+
+Option defaults are evaluated when the options are registered, so they can be computed from the
+machine the program runs on. ```incfg::hardware()``` probes once the online and available CPUs,
+the cgroup CPU quota and memory limit (v1 or v2, including the limits of the parent cgroups),
+the physical memory, the L2/L3 cache sizes (from sysfs) and the page size:
+
+```
+INCFG_REQUIRE( unsigned int, THREADS, incfg::hardware().cpus(), "Worker threads" )
+INCFG_REQUIRE( incfg::ByteSize, BLOCK_SIZE, incfg::ByteSize( std::max( incfg::hardware().l2_cache / 2, 65536ULL ) ), "Block size" )
+```
+
+```cpus()``` caps the CPUs of the affinity mask by the CPU quota, and ```usable_memory()``` caps the
+physical memory by the cgroup limit. Facts that cannot be read are 0. Computed defaults are shown by
+```to_config_string()``` and are overridden by configuration files and the command line as usual.
+
+## Enum options
+
+Enums whose values are 0, 1, 2... can be used as option types once the names of their enumerators
+are declared with ```INCFG_ENUM``` (in the global namespace):
+
+```
+enum class Mode { Fast, Safe, Debug };
+INCFG_ENUM( Mode, "fast", "safe", "debug" )
+INCFG_REQUIRE( Mode, MODE, Mode::Safe, "Processing mode" )
+
+switch( INCFG_GET( MODE ) ) { ... }
+```
+
+Names are parsed with a perfect hash table built at compile time (one hash and one comparison) and
+formatted with a table lookup. Values are stored as integers, so enum options are published like
+numbers and can select function variants (See below).
+
+
+## Dumping the configuration as JSON or binary
+
+Besides the commented configuration string, the current configuration can be dumped as a
+compact JSON object (with numbers and booleans written as JSON literals) or in a compact
+binary format that is trivial to parse (See ```ConfigOptions::to_binary()``` for the layout):
+
+```
+std::string json = incfg::ConfigOptions::instance().to_json();
+// {"BUFFER_SIZE":4096,"DEBUG_LOG":false,"LOGFILENAME":"log.txt"}
+```
+
+Both serializers write their output in small chunks to an ```incfg::Sink```, so that
+the dump can be streamed anywhere without intermediate allocations:
+
+```
+class FdSink : public incfg::Sink
+{
+public:
+    explicit FdSink( int _fd ) : fd(_fd) {}
+    void write( const char* data, size_t len ) { ::write( fd, data, len ); }
+private:
+    int fd;
+};
+
+FdSink sink( fd );
+incfg::ConfigOptions::instance().to_json( sink );
+```
+
+
+## Freezing a configuration at compile time
+
+Binaries specialized for a fixed configuration can have their option values turned into
+compile-time constants. Load the configuration as usual and generate a header with
+```to_frozen_header()```:
+
+```
+incfg::ConfigOptions::instance().load( ifs );
+std::ofstream ofs( "frozen_config.hpp" );
+ofs << incfg::ConfigOptions::instance().to_frozen_header();
+```
+
+Then rebuild with ```-DINCFG_FROZEN_CONFIG='"frozen_config.hpp"'```. Every option of a fundamental
+arithmetic type (or ```bool```) becomes a constant: ```INCFG_GET()``` can be folded by the compiler
+(loops bounded by ```INCFG_GET( BUFFER_SIZE )``` get specialized, ```if( INCFG_GET( DEBUG_LOG ) )```
+disappears), ```INCFG_SET()``` on them is a compile error and loading a different value for them
+throws an exception. Other options keep working as usual.
+
+
+## C++20 module
+
+With C++20 (and CMake 3.28 or newer, configuring with ```-DINCFG_BUILD_MODULE=ON```) incfg is also
+available as the ```incfg``` named module. Since macros are not exported by modules, options are
+declared with ```incfg::Required```, whose key is a template argument:
+
+```
+import incfg;
+
+inline incfg::Required< "BUFFER_SIZE", unsigned int > BUFFER_SIZE( 4096, "Buffer size used to write the log file" );
+
+void logtofile( std::string log_data )
+{
+    char* buff = new char[ BUFFER_SIZE.get() ];
+    // ...
+}
+```
+
+```incfg::Required``` is also available from ```incfg.hpp``` when compiling in C++20 mode.
+
+
+## Streaming configurations
+
+Configurations produced by another process can be loaded straight from a pipe or from stdin
+with ```load_fd()```, which reads large blocks and publishes all the values as a single version at
+end of file (nothing is applied if the input has an error):
+
+```
+incfg::ConfigOptions::instance().load_fd( STDIN_FILENO );
+```
+
+Input received in chunks (eg. from a socket or an event loop) can be pushed to an ```incfg::Parser```.
+Complete lines are tokenized in place and only the last incomplete line is buffered, so memory
+does not grow with the input text (only with the options staged until ```finish()``` publishes them):
+
+```
+incfg::Parser parser;
+parser.feed( chunk, chunk_len );   // as many times as needed
+parser.finish();
+```
+
+Lines longer than ```INCFG_MAX_LINE_LENGTH``` (1 MiB unless defined otherwise) are rejected with
+```Errc::line_too_long```; the limit of a parser or of ```load_fd()``` can also be given explicitly.
+
+
+## Changing options at runtime
+
+Options of trivially copyable types fitting in 64 bits (numbers, ```bool```, durations, sizes...)
+and ```std::string``` options are *published*: their value is kept in an atomic word (strings as a
+pointer to an immutable copy), so they can be changed with ```INCFG_SET()```
+(or a new ```load()```) while other threads read them. Each change publishes a new version of the
+configuration (See ```ConfigOptions::version()```); several changes can be grouped in a single
+version with a ```ConfigOptions::Publication```:
+
+```
+{
+    incfg::ConfigOptions::Publication publication( incfg::ConfigOptions::instance() );
+    INCFG_SET( BUFFER_SIZE, 8192 );
+    INCFG_SET( DEBUG_LOG, true );
+}
+```
+
+Values can also be staged without holding the publication lock, and published later as a single
+version (with one notification) by an ```incfg::Batch```:
+
+```
+incfg::Batch batch;
+INCFG_BATCH_SET( batch, BUFFER_SIZE, 8192 );
+INCFG_BATCH_SET( batch, DEBUG_LOG, true );
+batch.commit();
+```
+
+Options of other types must not be changed while being read.
+
+```INCFG_GET()``` returns a copy of a ```std::string``` option. References to the published copy
+are only handed out within an ```incfg::ConfigOptions::ReadSection``` held by the caller, and stay
+valid until it ends: a value replaced meanwhile is freed by a later publication.
+
+```
+const incfg::ConfigOptions::ReadSection section;
+auto [host, port] = incfg::get_consistent( section, INCFG_OPTION( HOST ), INCFG_OPTION( PORT ) );
+```
+
+Read sections are tracked per thread up to ```INCFG_MAX_READER_THREADS``` threads. Other threads
+hold the writer lock during their sections instead.
+
+Related options can be read from the same version, even while a reload is being published, with
+```incfg::get_consistent()```. The whole batch is validated with a single sequence check:
+
+```
+auto [host, port, timeout] = incfg::get_consistent( INCFG_OPTION( HOST ), INCFG_OPTION( PORT ), INCFG_OPTION( TIMEOUT ) );
+```
+
+Components copying options into a plain struct (read in hot loops without any accessor) can bind
+its fields with ```INCFG_BIND```, in the global namespace. ```incfg::refresh()``` then copies all of
+them from the same version in one pass, and does nothing if the configuration did not change:
+
+```
+struct Settings : incfg::BoundStruct { size_t buffer_size; bool debug; };
+INCFG_BIND( Settings, buffer_size, BUFFER_SIZE )
+INCFG_BIND( Settings, debug, DEBUG_LOG )
+
+Settings settings;
+incfg::refresh( settings );   // eg. before each batch of work
+```
+
+Each option also counts the changes of its value: ```INCFG_VERSION( KEY )``` is incremented by
+```set()``` (and loads) only when the new value differs, so a component deriving expensive state from
+an option can skip the rebuild when other options are reloaded:
+
+```
+if( INCFG_VERSION( TABLE_SIZE ) != table_version )
+{
+    table_version = INCFG_VERSION( TABLE_SIZE );
+    rebuild_table( INCFG_GET( TABLE_SIZE ) );
+}
+```
+
+Once the startup configuration is loaded, ```ConfigOptions::seal()``` makes it read-only: ```INCFG_SET```
+and ```load()``` then throw a ```std::logic_error``` if they change a value (nothing is applied), and so
+do registrations, so options of any type can be read from any thread without synchronization. Startup-only options can also be sealed individually with
+```co.seal( { "THREADS", "LOG_DIR" } )```, while the others keep being reloaded.
+
+bool options are packed as bits of shared words, 64 per word in registration order, so a reload
+flipping many flags stores a few words. Flags declared together can be tested with a single mask:
+
+```
+static const auto verbose = incfg::flags( INCFG_OPTION( DEBUG_LOG ), INCFG_OPTION( TRACE ) );
+if( verbose.any() ) ...
+```
+
+On multi-socket machines, ```ConfigOptions::enable_numa_replicas()``` keeps a replica of the published
+values on each NUMA node: threads read the replica local to their node, so reloads do not make every
+core fetch the new values from a remote socket. ```bench/numa_replicas.cpp``` measures the read
+throughput of pinned threads with and without replicas.
+
+Reading options never allocates nor locks, except for the copy of a ```std::string``` value returned
+by ```INCFG_GET()```: ```test_alloc.cpp``` (the ```incfgTEST_alloc``` test, on Linux)
+interposes ```malloc```/```free``` and ```pthread_mutex_lock``` to check every read API with and without
+replicas and once sealed, and prints the allocations of ```load()``` and ```to_config_string()``` as metrics.
+
+
+## Auto-tuning numeric options
+
+```incfg_tuner.hpp``` provides an opt-in ```incfg::Tuner```, which adjusts a bounded numeric option
+to maximize an objective measured by the application (eg. the throughput of the last interval).
+It climbs by linear or geometric steps, keeping a new value only if the objective improved and
+shrinking the step around the best value. If the option is set by someone else (eg. a reload), the
+search restarts from the new value. It publishes with the option setter, and its decisions are
+recorded in a bounded ```history()```:
+
+```
+#include "incfg_tuner.hpp"
+
+incfg::Tuner< unsigned int > tuner( INCFG_OPTION( BUFFER_SIZE ), incfg::geometric_policy( 512u, 1u << 20, 2.0 ),
+                                    [&]() { return stats.throughput_since_last_call(); } );
+tuner.start( std::chrono::seconds( 10 ) );   // or call tuner.step() after each batch of work
+```
+
+
+## Function multiversioning
+
+Branches on options in hot loops (```if( INCFG_GET( DEBUG_LOG ) )```) are cheap when predicted, but
+they still prevent some optimizations such as vectorization. ```incfg::multiversion()``` instantiates a
+function template for every combination of values of some bool or enum options, and selects the matching
+variant again each time a publication changes options, so the hot loop runs a body without the branches:
+
+```
+struct Process
+{
+    template <bool DEBUG_LOG, bool CHECKSUM>
+    static void run( Buffer& buffer ) { ... }
+};
+
+static auto process = incfg::multiversion< Process, void (*)( Buffer& ) >( INCFG_OPTION( DEBUG_LOG ), INCFG_OPTION( CHECKSUM ) );
+process( buffer );   // a single atomic load of the function pointer, then the specialized body
+```
+
+
+## Change notifications
+
+Event loops can wait for new versions without polling and without extra threads:
+```ConfigOptions::notification_fd()``` returns a file descriptor (an eventfd on Linux) that becomes
+readable when a version changing one of the given options is published. The loop then fetches the
+change set on its own thread, which also rearms the descriptor:
+
+```
+int fd = co.notification_fd( { "BUFFER_SIZE", "DEBUG_LOG" } );   // all the options if empty
+// ... add fd to epoll, and when readable:
+co.fetch_changes( fd, []( incfg::Option& opt ) { std::cout << opt.name << " changed\n"; } );
+// ...
+co.close_notification_fd( fd );
+```
+
+
+## Memory usage
+
+```ConfigOptions::memory_usage()``` returns the bytes used by the configuration, split into the registry,
+keys, option objects, descriptions, string values and NUMA replicas. It is computed in constant time
+from counters maintained when memory is allocated, so it can be sampled cheaply (eg. exported as a metric).
+
+
 ## Customizing configuration option types
 
 Each configuration option is saved/loaded as a string. By default the conversion
-between an option type and a string is handled by ```std::stringstream``` but uncommon
+between an option type and a string is handled by ```std::stringstream``` (so any type
+with the ```<<``` and ```>>``` stream operators can be used) but uncommon
 types can be handled as well by defining the two template functions:
 
 ```
@@ -200,10 +525,55 @@ namespace incfg
 }
 ```
 
+The loaders convert values with the non-throwing ```parse_value()```, which returns an
+```incfg::Expected< T >``` holding the value or an error message. Its generic version relies on
+```from_string_helper()```, so specializing it is only required in exception-free builds, but it is
+the cheaper customization point:
+
+```
+namespace incfg
+{
+    template < >
+    inline Expected< T > parse_value< T >( const std::string& str, const T& mytype )
+    {
+        // return T parsed from str, or Unexpected( "error message" )
+    }
+}
+```
+
+
+## Embedded profile
+
+For targets where the heap is forbidden after boot, define ```INCFG_EMBEDDED``` before including
+```incfg.hpp``` (and do not compile ```incfg.cpp```): ```incfg_embedded.hpp``` then provides the same
+```INCFG_REQUIRE```, ```INCFG_GET``` and ```INCFG_SET``` macros over a registry of at most
+```INCFG_MAX_OPTIONS``` options, with strings stored inline (```incfg::InlineString< N >```). It never
+allocates, throws or uses RTTI, so it builds with ```-fno-exceptions -fno-rtti```:
+
+```
+INCFG_REQUIRE( incfg::InlineString< 32 >, DEVICE, "uart0", "Device name" )
+
+incfg::Status status = incfg::ConfigOptions::instance().load( buffer, length );
+if( !status )
+    log( "config line %u: %s", status.line, status.message() );
+```
+
+Configurations are parsed from caller buffers (```incfg::Parser``` keeps partial lines in a buffer
+given by the caller), and custom types provide non-throwing ```parse_value()```/```format_value()```.
+
 
 # Installing
 
-Just import ```incfg.hpp``` and ```incfg.cpp``` in your project :)
+Just import ```incfg.hpp``` and ```incfg.cpp``` (and ```incfg_units.hpp``` or ```incfg_tuner.hpp``` if needed) in your project :)
+
+With CMake, incfg can be added as a subdirectory and linked as the ```incfg``` static library
+(built with link-time optimization when the compiler supports it).
+
+incfg can also be used header-only: define ```INCFG_HEADER_ONLY``` before including ```incfg.hpp```
+(or link the ```incfg_header_only``` CMake target) and do not compile ```incfg.cpp```.
+
+incfg requires C++17. Options are stored in inline variables, so ```INCFG_GET()``` is a plain
+read of the option value that the compiler can inline everywhere.
 
 
 # License
@@ -234,22 +604,81 @@ THE SOFTWARE.
 #ifndef INCFG_INCFG_HPP
 #define INCFG_INCFG_HPP
 
+// Embedded profile: fixed-capacity registry without heap, exceptions or RTTI (See incfg_embedded.hpp)
+#ifdef INCFG_EMBEDDED
+#include "incfg_embedded.hpp"
+#else
 
-#include <stddef.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
 #include <iosfwd>
 #include <string>
-#include <map>
-#include <sstream>
-#include <iostream>
 #include <stdexcept>
-#include <algorithm>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 
 /*! \file incfg.hpp
  * \brief incfg hpp header
  *
+ * This header is included by every translation unit declaring or reading an option, so it is kept
+ * as light as possible: the parsing and formatting machinery (and the heavy standard headers it needs)
+ * lives in incfg.cpp.
+ *
+ * If INCFG_HEADER_ONLY is defined before including this header, incfg.cpp is included as well
+ * with all its definitions declared inline, and must not be compiled separately.
  */
 
+#ifdef INCFG_HEADER_ONLY
+#define INCFG_INLINE inline
+#else
+#define INCFG_INLINE
+#endif
+
+/*!
+ * Maximum number of NUMA nodes holding a replica of the published values (See ConfigOptions::enable_numa_replicas)
+ */
+#ifndef INCFG_MAX_NUMA_NODES
+#define INCFG_MAX_NUMA_NODES 64
+#endif
+
+/*!
+ * Default maximum length in bytes of a configuration line read by a Parser or load_fd(), bounding the
+ * memory buffered for an incomplete line of an untrusted input (See Parser::Parser)
+ */
+#ifndef INCFG_MAX_LINE_LENGTH
+#define INCFG_MAX_LINE_LENGTH (1 << 20)
+#endif
+
+/*!
+ * Maximum number of threads tracked at once as readers of string options. Other threads read strings
+ * with the writer lock held instead (See ConfigOptions::ReadSection)
+ */
+#ifndef INCFG_MAX_READER_THREADS
+#define INCFG_MAX_READER_THREADS 256
+#endif
+
+/*!
+ * Exception-free build mode, selected automatically when exceptions are disabled (eg. -fno-exceptions):
+ * the try_ loaders and parse_value() report errors as values, and the errors only the throwing API
+ * can report (eg. a key registered twice) call the fail handler instead (See set_fail_handler).
+ */
+#if !defined(INCFG_NO_EXCEPTIONS) && !defined(__cpp_exceptions) && !defined(__EXCEPTIONS)
+#define INCFG_NO_EXCEPTIONS
+#endif
+
+#ifdef INCFG_NO_EXCEPTIONS
+#define INCFG_THROW( EXCEPTION ) incfg::fail( ( EXCEPTION ).what() )
+#else
+#define INCFG_THROW( EXCEPTION ) throw EXCEPTION
+#endif
+
 namespace incfg
 {
     /*!
@@ -274,227 +703,2326 @@ namespace incfg
 
 
     /*!
-     *  Generic to string converter via std::stringstream
+     * \brief Function called on unrecoverable errors in exception-free builds (the program is aborted if it returns)
      */
-    template <typename T> std::string to_string_helper( T val )
+    typedef void (*FailHandler)( const char* message );
+
+    inline FailHandler fail_handler = 0;
+
+    inline void set_fail_handler( FailHandler handler ) { fail_handler = handler; }
+
+    [[noreturn]] inline void fail( const char* message )
     {
-        std::stringstream ss;
-        ss << val;
-        return ss.str();
+        if( fail_handler )
+            fail_handler( message );
+        std::abort();
     }
 
 
     /*!
-     * Generic from string converter via std::stringstream
+     * \brief Error codes of the non-throwing loaders (See Status)
      */
-    template <typename T>
-    T from_string_helper( std::string str, const T& mytype )
+    enum class Errc
     {
-        T val;
-        std::stringstream ss(str);
-        ss >> val;
-        if( ss.fail() )
-            throw StringParseException("Unable to parse "+str+" to its defined type");
+        ok,
+        unknown_key,        //!< the key is not registered
+        invalid_value,      //!< the value cannot be parsed to the option type
+        syntax_error,       //!< the line (or command-line argument) is malformed
+        line_too_long,      //!< the line is longer than the Parser limit
+        missing_value,      //!< a command-line key is not followed by its value
+        io_error,           //!< the source cannot be read
+        frozen,             //!< the option is frozen to a different value in this build
+        sealed              //!< the option (or the whole configuration) is sealed
+    };
 
-        return val;
-    }
 
-    template < >
-    inline bool from_string_helper( std::string str, const bool& mytype )
+    /*!
+     * \brief Result of a non-throwing load: an error code, the line (or argv index) where it occurred and a message
+     */
+    struct Status
     {
-        if( str.compare(std::string("true"))!=0 && str.compare(std::string("false"))!=0 )
-            throw StringParseException("Unable to parse "+str+" to \"true\" or \"false\"");
+        Status() : code( Errc::ok ), line( 0 ) {}
+        Status( Errc _code, size_t _line, const std::string& _text ) : code( _code ), line( _line ), text( _text ) {}
 
-        return str.compare( std::string("true") )==0;
-    }
+        bool ok() const { return code == Errc::ok; }
+        explicit operator bool() const { return ok(); }
+        const char* message() const { return ok() ? "Success" : text.c_str(); }
 
+        /*!
+         * \brief Throws the exception reported by the throwing API for this error (if any): a StringParseException
+         *        for invalid values, a std::logic_error once sealed and a ConfigOptionsLoadException otherwise
+         */
+        inline void raise() const
+        {
+            if( code != Errc::ok )
+                raise_error();
+        }
 
-    template < >
-    inline std::string from_string_helper( std::string str, const std::string& mytype )
-    {
-        if( str.length()<2 )
-            return str;
+        Errc code;
+        size_t line;        //!< 1-based line or argv index, 0 if unknown
+        std::string text;
 
-        // remove quotes if necessary
-        if( str[0]=='\"' && str[str.length()-1]=='\"')
-            return str.substr(1,str.length()-2);
+    private:
+        [[noreturn]] INCFG_INLINE void raise_error() const;
+    };
 
-        return str;
-    }
 
-    template <  >
-    inline std::string to_string_helper< std::string >( std::string val )
+    /*!
+     * \brief Error of a non-throwing conversion (See Expected)
+     */
+    struct Unexpected
     {
-        return std::string("\"")+val+std::string("\"");
-    }
+        explicit Unexpected( const std::string& _message ) : message( _message ) {}
+        std::string message;
+    };
 
-    template <  >
-    inline std::string to_string_helper< char* >( char* val )
+
+    /*!
+     * \brief Result of a non-throwing conversion: the value, or the message of the error (as std::expected)
+     */
+    template <typename T>
+    class Expected
     {
-        return std::string("\"")+val+std::string("\"");
-    }
+    public:
+        Expected( const T& _value ) : val( _value ), has_val( true ) {}
+        Expected( const Unexpected& _error ) : val(), err( _error.message ), has_val( false ) {}
 
-    template <  >
-    inline std::string to_string_helper< bool >( bool val )
+        bool has_value() const { return has_val; }
+        explicit operator bool() const { return has_val; }
+        const T& value() const { return val; }
+        const T& operator*() const { return val; }
+        const T* operator->() const { return &val; }
+        const std::string& error() const { return err; }
+
+    private:
+        T val;
+        std::string err;
+        bool has_val;
+    };
+
+
+    namespace detail
     {
-        return val ? std::string("true") : std::string("false");
-    }
+        // Type-erased std::stringstream conversions, implemented in incfg.cpp
+        INCFG_INLINE std::string write_to_stream( const void* val, void (*writer)( std::ostream&, const void* ) );
+        INCFG_INLINE bool read_from_stream( const std::string& str, void* val, void (*reader)( std::istream&, void* ) );
 
+        template <typename T>
+        void stream_writer( std::ostream& os, const void* val ) { os << *static_cast< const T* >( val ); }
 
-    template <typename T>
-    inline bool is_boolean( T _type ) { return false; }
+        template <typename T>
+        void stream_reader( std::istream& is, void* val ) { is >> *static_cast< T* >( val ); }
 
-    template < >
-    inline bool is_boolean< bool >( bool _type ) { return true; }
+        // Quantities with units (See incfg_units.hpp), parsed and formatted in incfg.cpp
+        enum QuantityKind { QUANTITY_DURATION, QUANTITY_BYTES };
 
+        // Parses "<number>[<unit>]" into base units (nanoseconds or bytes). has_unit is false if no unit was given.
+        INCFG_INLINE bool parse_quantity( const std::string& str, QuantityKind kind, long double& value, bool& has_unit );
 
-    /**
-     * @brief Configuration option interface
-     */
-    class Option
-    {
-    public:
-        Option( const char* _name, const char* _description );
-        const std::string name;
-        const std::string description;
-        virtual void parse_value_from_str( std::string str ) = 0;
-        virtual std::string get_value_as_str() const = 0;
-        virtual bool is_default() const = 0;
-        virtual bool is_bool() const = 0;
-    };
+        // Formats a value given in base units with the largest unit representing it exactly
+        INCFG_INLINE std::string format_quantity( long double value, QuantityKind kind );
 
+        // Quotes a string value for the text format, escaping '"', '\\', newlines and carriage returns
+        INCFG_INLINE std::string quote( const char* str, size_t len );
 
-    /*!
-     * \brief ConfigOptions Class collects and manages all the required key-value pairs
-     *
-     * ConfigOptions is the main class used by incfg to manage all the required key-value pairs.
-     * Before the execution of main(), all the REQUIRED configuration options (defined via INCFG_REQUIRE macro)
-     * are automatically collected via ConfigOptions singleton class and initialized with their default value and
-     * description.
+        // Heap bytes held by a value: only std::string values outside of their internal buffer are accounted
+        template <typename T>
+        inline size_t heap_bytes( const T& ) { return 0; }
+
+        inline size_t heap_bytes( const std::string& str )
+        {
+            return str.capacity() > std::string().capacity() ? str.capacity()+1 : 0;
+        }
+
+        /*
+         * How values of type T are published in a 64-bit atomic word (See ConfigOptions::version).
+         * Trivially copyable types fitting in 64 bits are stored bitwise. Other types are not published.
+         */
+        template <typename T, typename ENABLE = void>
+        struct Published
+        {
+            static const bool value = false;
+            static const bool owns_memory = false;
+        };
+
+        template <typename T>
+        struct Published< T, typename std::enable_if< std::is_trivially_copyable< T >::value &&
+                                                      std::is_default_constructible< T >::value &&
+                                                      sizeof( T ) <= sizeof( unsigned long long ) >::type >
+        {
+            static const bool value = true;
+            static const bool owns_memory = false;
+            static const std::memory_order load_order = std::memory_order_relaxed;
+            typedef T read_type;
+
+            static inline unsigned long long encode( const T& val )
+            {
+                unsigned long long bits = 0;
+                std::memcpy( &bits, &val, sizeof( T ) );
+                return bits;
+            }
+
+            static inline T decode( unsigned long long bits )
+            {
+                // Copied through void*: T is trivially copyable, but may have private members (eg. durations)
+                T val;
+                std::memcpy( static_cast< void* >( &val ), &bits, sizeof( T ) );
+                return val;
+            }
+
+            static inline void release( unsigned long long ) {}
+        };
+
+        /*
+         * std::string values are published as a pointer to an immutable copy, read within a
+         * ConfigOptions::ReadSection. Copies replaced by a new value are retired, and freed once no read
+         * section started before can reference them anymore.
+         */
+        template < >
+        struct Published< std::string >
+        {
+            static const bool value = true;
+            static const bool owns_memory = true;
+            static const std::memory_order load_order = std::memory_order_acquire;
+            typedef const std::string& read_type;
+
+            static inline unsigned long long encode( const std::string& val )
+            {
+                return static_cast< unsigned long long >( reinterpret_cast< std::uintptr_t >( new std::string( val ) ) );
+            }
+
+            static inline const std::string& decode( unsigned long long bits )
+            {
+                return *reinterpret_cast< const std::string* >( static_cast< std::uintptr_t >( bits ) );
+            }
+
+            static inline void release( unsigned long long bits )
+            {
+                delete reinterpret_cast< const std::string* >( static_cast< std::uintptr_t >( bits ) );
+            }
+        };
+
+        template <typename T>
+        struct is_published : std::integral_constant< bool, Published< T >::value > {};
+
+        // A unique address for each option type, used to check that an option is required with the same type everywhere
+        template <typename T>
+        struct TypeId { static constexpr char id = 0; };
+
+        // Value storage of a TypedOption: a plain value, or an atomic word for published types
+        template <typename T, bool PUBLISHED = is_published< T >::value>
+        struct OptionValue
+        {
+            explicit OptionValue( const T& val ) : value( val ) {}
+            inline const T& load() const { return value; }
+            inline void store( const T& val ) { value = val; }
+            inline std::atomic< unsigned long long >* word() { return 0; }
+            T value;
+        };
+
+        template <typename T>
+        struct OptionValue< T, true >
+        {
+            explicit OptionValue( const T& val ) : bits( Published< T >::encode( val ) ) {}
+            ~OptionValue() { Published< T >::release( bits.load( std::memory_order_relaxed ) ); }
+            inline typename Published< T >::read_type load() const { return Published< T >::decode( bits.load( Published< T >::load_order ) ); }
+            inline typename Published< T >::read_type decode( unsigned long long word_bits ) const { return Published< T >::decode( word_bits ); }
+            inline unsigned long long encode( const T& val ) const { return Published< T >::encode( val ); }
+            inline std::atomic< unsigned long long >* word() { return &bits; }
+            std::atomic< unsigned long long > bits;
+
+        private:
+            OptionValue( const OptionValue& other );
+            OptionValue& operator=( const OptionValue& other );
+        };
+
+        // bool values are packed as bits of words shared by several options (See ConfigOptions::allocate_flag)
+        template < >
+        struct OptionValue< bool, true >
+        {
+            explicit OptionValue( bool ) : flags( 0 ), mask( 0 ) {}
+            inline bool load() const { return decode( flags->load( std::memory_order_relaxed ) ); }
+            inline bool decode( unsigned long long word_bits ) const { return ( word_bits & mask ) != 0; }
+
+            inline unsigned long long encode( bool val ) const
+            {
+                // Writers are serialized by the publication lock: the other flags of the word cannot change meanwhile
+                const unsigned long long word_bits = flags->load( std::memory_order_relaxed );
+                return val ? word_bits | mask : word_bits & ~mask;
+            }
+
+            inline std::atomic< unsigned long long >* word() { return flags; }
+            std::atomic< unsigned long long >* flags;
+            unsigned long long mask;
+
+        private:
+            OptionValue( const OptionValue& other );
+            OptionValue& operator=( const OptionValue& other );
+        };
+    }
+
+
+    /*!
+     *  Generic to string converter via std::stringstream
+     *
+     *  The stream insertion operator of T is only needed where the converter is instantiated, so
+     *  custom types must provide it together with their own declaration.
+     */
+    template <typename T> std::string to_string_helper( T val )
+    {
+        return detail::write_to_stream( &val, &detail::stream_writer< T > );
+    }
+
+
+    /*!
+     * Generic from string converter via std::stringstream
+     */
+    template <typename T>
+    T from_string_helper( std::string str, const T& mytype )
+    {
+        T val;
+        if( !detail::read_from_stream( str, &val, &detail::stream_reader< T > ) )
+            INCFG_THROW( StringParseException("Unable to parse "+str+" to its defined type") );
+
+        return val;
+    }
+
+
+    /*!
+     * Generic non-throwing from string converter, used by the loaders. Types converted by a
+     * from_string_helper specialization are supported through it, unless exceptions are disabled:
+     * parse_value must then be specialized instead.
+     */
+    template <typename T>
+    Expected< T > parse_value( const std::string& str, const T& mytype )
+    {
+#ifdef INCFG_NO_EXCEPTIONS
+        T val;
+        if( !detail::read_from_stream( str, &val, &detail::stream_reader< T > ) )
+            return Unexpected("Unable to parse "+str+" to its defined type");
+
+        return val;
+#else
+        try
+        {
+            return from_string_helper< T >( str, mytype );
+        } catch( StringParseException& ex )
+        {
+            return Unexpected( ex.what() );
+        }
+#endif
+    }
+
+
+    namespace detail
+    {
+        // from_string_helper of the types converted by a parse_value specialization
+        template <typename T>
+        inline T value_or_throw( const Expected< T >& result )
+        {
+            if( !result )
+                INCFG_THROW( StringParseException( result.error() ) );
+
+            return *result;
+        }
+    }
+
+
+    // Conversions of the fundamental types are instantiated once in incfg.cpp
+#define INCFG_DECLARE_STREAM_CONVERSIONS( TYPE ) \
+    template < > INCFG_INLINE std::string to_string_helper< TYPE >( TYPE val ); \
+    template < > INCFG_INLINE TYPE from_string_helper< TYPE >( std::string str, const TYPE& mytype ); \
+    template < > INCFG_INLINE Expected< TYPE > parse_value< TYPE >( const std::string& str, const TYPE& mytype );
+
+    INCFG_DECLARE_STREAM_CONVERSIONS( char )
+    INCFG_DECLARE_STREAM_CONVERSIONS( signed char )
+    INCFG_DECLARE_STREAM_CONVERSIONS( unsigned char )
+    INCFG_DECLARE_STREAM_CONVERSIONS( short )
+    INCFG_DECLARE_STREAM_CONVERSIONS( unsigned short )
+    INCFG_DECLARE_STREAM_CONVERSIONS( int )
+    INCFG_DECLARE_STREAM_CONVERSIONS( unsigned int )
+    INCFG_DECLARE_STREAM_CONVERSIONS( long )
+    INCFG_DECLARE_STREAM_CONVERSIONS( unsigned long )
+    INCFG_DECLARE_STREAM_CONVERSIONS( long long )
+    INCFG_DECLARE_STREAM_CONVERSIONS( unsigned long long )
+    INCFG_DECLARE_STREAM_CONVERSIONS( float )
+    INCFG_DECLARE_STREAM_CONVERSIONS( double )
+    INCFG_DECLARE_STREAM_CONVERSIONS( long double )
+
+#undef INCFG_DECLARE_STREAM_CONVERSIONS
+
+
+    template < >
+    inline Expected< bool > parse_value( const std::string& str, const bool& mytype )
+    {
+        if( str.compare(std::string("true"))!=0 && str.compare(std::string("false"))!=0 )
+            return Unexpected("Unable to parse "+str+" to \"true\" or \"false\"");
+
+        return str.compare( std::string("true") )==0;
+    }
+
+    template < >
+    inline bool from_string_helper( std::string str, const bool& mytype )
+    {
+        return detail::value_or_throw( parse_value< bool >( str, mytype ) );
+    }
+
+
+    template < >
+    inline std::string from_string_helper( std::string str, const std::string& mytype )
+    {
+        if( str.length()<2 )
+            return str;
+
+        // remove quotes if necessary
+        if( str[0]=='\"' && str[str.length()-1]=='\"')
+            return str.substr(1,str.length()-2);
+
+        return str;
+    }
+
+    template < >
+    inline Expected< std::string > parse_value( const std::string& str, const std::string& mytype )
+    {
+        return from_string_helper< std::string >( str, mytype );
+    }
+
+    template <  >
+    inline std::string to_string_helper< std::string >( std::string val )
+    {
+        return detail::quote( val.data(), val.length() );
+    }
+
+    template <  >
+    inline std::string to_string_helper< char* >( char* val )
+    {
+        return detail::quote( val, std::strlen( val ) );
+    }
+
+    template <  >
+    inline std::string to_string_helper< bool >( bool val )
+    {
+        return val ? std::string("true") : std::string("false");
+    }
+
+
+    template <typename T>
+    inline bool is_boolean( T _type ) { return false; }
+
+    template < >
+    inline bool is_boolean< bool >( bool _type ) { return true; }
+
+
+    /*!
+     * C++ spelling of the option types whose value can be frozen at compile time
+     * (See ConfigOptions::to_frozen_header). NULL for any other type.
+     */
+    template <typename T>
+    struct TypeName { static constexpr const char* value = 0; };
+
+#define INCFG_DECLARE_TYPE_NAME( TYPE ) \
+    template < > struct TypeName< TYPE > { static constexpr const char* value = # TYPE; };
+
+    INCFG_DECLARE_TYPE_NAME( bool )
+    INCFG_DECLARE_TYPE_NAME( short )
+    INCFG_DECLARE_TYPE_NAME( unsigned short )
+    INCFG_DECLARE_TYPE_NAME( int )
+    INCFG_DECLARE_TYPE_NAME( unsigned int )
+    INCFG_DECLARE_TYPE_NAME( long )
+    INCFG_DECLARE_TYPE_NAME( unsigned long )
+    INCFG_DECLARE_TYPE_NAME( long long )
+    INCFG_DECLARE_TYPE_NAME( unsigned long long )
+    INCFG_DECLARE_TYPE_NAME( float )
+    INCFG_DECLARE_TYPE_NAME( double )
+
+#undef INCFG_DECLARE_TYPE_NAME
+
+
+    /*!
+     * \brief Names of the enumerators of an enum option type, in the order of their values (See INCFG_ENUM)
+     */
+    template <typename E>
+    struct EnumNames;
+
+
+    namespace detail
+    {
+        constexpr unsigned int enum_hash( const char* str, size_t len, unsigned int seed )
+        {
+            unsigned int h = 2166136261u ^ seed;
+            for( size_t i=0; i<len; ++i )
+                h = ( h ^ static_cast< unsigned char >( str[i] ) ) * 16777619u;
+            return h;
+        }
+
+        constexpr size_t enum_name_length( const char* str )
+        {
+            size_t len = 0;
+            while( str[len] )
+                ++len;
+            return len;
+        }
+
+        /*
+         * Perfect hash table of the names of an enum, built at compile time: the seed is searched so that
+         * all the names hash to distinct slots, each holding the index of its enumerator + 1 (0 if empty).
+         * Parsing a name costs one hash and one comparison.
+         */
+        template <typename E>
+        struct EnumTable
+        {
+            static constexpr size_t count = sizeof( EnumNames< E >::names ) / sizeof( EnumNames< E >::names[0] );
+
+            static constexpr size_t size()
+            {
+                size_t n = 1;
+                while( n < 2*count )
+                    n *= 2;
+                return n;
+            }
+
+            unsigned int seed;
+            unsigned short slots[ size() ];
+
+            static constexpr EnumTable make()
+            {
+                EnumTable table = {};
+                for( table.seed=0; table.seed<65536; ++table.seed )
+                {
+                    bool distinct = true;
+                    for( size_t i=0; i<size(); ++i )
+                        table.slots[i] = 0;
+                    for( size_t i=0; i<count && distinct; ++i )
+                    {
+                        const char* name = EnumNames< E >::names[i];
+                        unsigned short& slot = table.slots[ enum_hash( name, enum_name_length( name ), table.seed ) & ( size()-1 ) ];
+                        distinct = slot == 0;
+                        slot = static_cast< unsigned short >( i+1 );
+                    }
+                    if( distinct )
+                        return table;
+                }
+                return table;
+            }
+        };
+
+        template <typename E>
+        struct EnumHash
+        {
+            static constexpr EnumTable< E > table = EnumTable< E >::make();
+            static_assert( table.seed < 65536, "Enum names must be distinct (See INCFG_ENUM)" );
+        };
+    }
+
+
+    /*!
+     * \brief returns the name of an enumerator declared with INCFG_ENUM (NULL if out of range)
+     */
+    template <typename E>
+    constexpr const char* enum_name( E val )
+    {
+        return static_cast< size_t >( val ) < detail::EnumTable< E >::count ? EnumNames< E >::names[ static_cast< size_t >( val ) ] : 0;
+    }
+
+
+    /*!
+     * \brief Parses the name (quoted or not) of an enumerator declared with INCFG_ENUM, without throwing
+     */
+    template <typename E>
+    inline Expected< E > enum_parse( const std::string& str )
+    {
+        const size_t quoted = str.length() >= 2 && str[0]=='\"' && str[str.length()-1]=='\"' ? 1 : 0;
+        const char* name = str.data() + quoted;
+        const size_t len = str.length() - 2*quoted;
+
+        const detail::EnumTable< E >& table = detail::EnumHash< E >::table;
+        const unsigned short idx = table.slots[ detail::enum_hash( name, len, table.seed ) & ( table.size()-1 ) ];
+        if( idx == 0 || str.compare( quoted, len, EnumNames< E >::names[ idx-1 ] ) != 0 )
+        {
+            std::string expected;
+            for( size_t i=0; i<detail::EnumTable< E >::count; ++i )
+                expected += std::string( i ? ", " : "" ) + EnumNames< E >::names[i];
+            return Unexpected("Unable to parse "+str+" to one of "+expected);
+        }
+        return static_cast< E >( idx-1 );
+    }
+
+
+    /*!
+     * \brief Parses the name (quoted or not) of an enumerator declared with INCFG_ENUM
+     */
+    template <typename E>
+    inline E enum_from_string( const std::string& str )
+    {
+        return detail::value_or_throw( enum_parse< E >( str ) );
+    }
+
+
+    /*!
+     * \brief Formats an enumerator declared with INCFG_ENUM (its integer value if out of range)
+     */
+    template <typename E>
+    inline std::string enum_to_string( E val )
+    {
+        const char* name = enum_name( val );
+        return name ? std::string( name ) : to_string_helper< long long >( static_cast< long long >( val ) );
+    }
+
+
+    /*!
+     * \brief Sink is the output interface used by the ConfigOptions serializers
+     *
+     * Serializers push their output in small chunks via write() and never buffer it
+     * themselves, so a Sink writing to a file descriptor or to a pre-allocated buffer
+     * makes the whole dump allocation-free.
+     */
+    class Sink
+    {
+    public:
+        virtual ~Sink() {}
+        virtual void write( const char* data, size_t len ) = 0;
+    };
+
+
+    /*!
+     * \brief A Sink appending everything to an std::string
+     */
+    class StringSink : public Sink
+    {
+    public:
+        explicit StringSink( std::string& _str ) : str(_str) {}
+        inline void write( const char* data, size_t len ) { str.append( data, len ); }
+    private:
+        std::string& str;
+    };
+
+
+    /*!
+     * \brief ValueWriter receives the typed value of an option during serialization
+     *
+     * Each option forwards its value to the overload of ```write_value()``` matching its type,
+     * so that serializers can preserve numbers and booleans instead of dealing with their
+     * string representation only.
+     */
+    class ValueWriter
+    {
+    public:
+        virtual ~ValueWriter() {}
+        virtual void write_bool( bool val ) = 0;
+        virtual void write_int( long long val ) = 0;
+        virtual void write_uint( unsigned long long val ) = 0;
+        virtual void write_real( double val ) = 0;
+        virtual void write_string( const char* str, size_t len ) = 0;
+    };
+
+
+    /*!
+     * Generic typed value writer. Types without a dedicated overload are written as
+     * strings, using their ```to_string_helper()``` representation.
+     */
+    template <typename T>
+    inline void write_value( ValueWriter& w, const T& val )
+    {
+        std::string str = to_string_helper< T >( val );
+        w.write_string( str.data(), str.length() );
+    }
+
+    inline void write_value( ValueWriter& w, const bool& val ) { w.write_bool( val ); }
+    inline void write_value( ValueWriter& w, const short& val ) { w.write_int( val ); }
+    inline void write_value( ValueWriter& w, const int& val ) { w.write_int( val ); }
+    inline void write_value( ValueWriter& w, const long& val ) { w.write_int( val ); }
+    inline void write_value( ValueWriter& w, const long long& val ) { w.write_int( val ); }
+    inline void write_value( ValueWriter& w, const unsigned short& val ) { w.write_uint( val ); }
+    inline void write_value( ValueWriter& w, const unsigned int& val ) { w.write_uint( val ); }
+    inline void write_value( ValueWriter& w, const unsigned long& val ) { w.write_uint( val ); }
+    inline void write_value( ValueWriter& w, const unsigned long long& val ) { w.write_uint( val ); }
+    inline void write_value( ValueWriter& w, const float& val ) { w.write_real( val ); }
+    inline void write_value( ValueWriter& w, const double& val ) { w.write_real( val ); }
+    inline void write_value( ValueWriter& w, const long double& val ) { w.write_real( static_cast<double>(val) ); }
+    inline void write_value( ValueWriter& w, const std::string& val ) { w.write_string( val.data(), val.length() ); }
+
+
+    class Batch;
+
+
+    /**
+     * @brief Configuration option interface
+     */
+    class Option
+    {
+    public:
+        Option( const char* _name, const char* _description, const void* _type_id )
+            : name(_name), description(_description), type_id(_type_id), word( 0 ), slot( 0 ), sealed( false ), changes( 0 ) {}
+        virtual ~Option() {}
+        const std::string name;
+        const std::string description;
+        const void* const type_id;      //!< Identifies the value type (See ConfigOptions::check_type)
+        virtual Status try_parse_value_from_str( const std::string& str ) = 0;
+        void parse_value_from_str( std::string str ) { try_parse_value_from_str( str ).raise(); }
+
+        /*!
+         * \brief Parses a value and stages it in a batch: the option keeps its value until the batch is committed
+         */
+        virtual Status try_stage_value_from_str( const std::string& str, Batch& batch ) = 0;
+        virtual std::string get_value_as_str() const = 0;
+        virtual void write_value( ValueWriter& w ) const = 0;
+        virtual bool is_default() const = 0;
+        virtual bool is_bool() const = 0;
+        virtual bool is_frozen() const = 0;
+        virtual const char* type_name() const = 0;
+
+        // Size of the option object and heap bytes held by its value (See ConfigOptions::memory_usage)
+        virtual size_t object_size() const { return sizeof( Option ); }
+        virtual size_t value_heap_bytes() const { return 0; }
+
+        /*!
+         * \brief returns true if the option can no longer be changed (See ConfigOptions::seal)
+         */
+        inline bool is_sealed() const { return sealed; }
+
+        /*!
+         * \brief returns the number of times the value of the option actually changed
+         *
+         * Setting an equal value does not count, so a component deriving state from the option can
+         * compare it with the version it cached to skip a rebuild. The counter is incremented once
+         * the new value is published: a thread seeing a new version then reads the new value.
+         */
+        inline unsigned long long version() const { return changes.load( std::memory_order_acquire ); }
+
+    protected:
+        friend class ConfigOptions;
+        template <size_t N> friend class FlagSet;
+
+        // Atomic word holding the value of a published option (NULL otherwise) and its index in the NUMA replicas
+        std::atomic< unsigned long long >* word;
+        size_t slot;
+
+        // Set by ConfigOptions::seal, with the publication lock held
+        bool sealed;
+
+        // Number of changes of the value (See version), incremented with the publication lock held
+        std::atomic< unsigned long long > changes;
+    };
+
+
+    namespace detail
+    {
+        // Type-erased visitor of a change set (See ConfigOptions::fetch_changes)
+        template <typename F>
+        void visit_change( Option& opt, void* visitor ) { (*static_cast< F* >( visitor ))( opt ); }
+    }
+
+
+    /*!
+     * \brief Memory used by the configuration, in bytes (See ConfigOptions::memory_usage)
+     */
+    struct MemoryUsage
+    {
+        size_t registry;        //!< Registry bookkeeping: map nodes and slot table (map nodes are estimated)
+        size_t keys;            //!< Heap bytes of the option keys, in the options and in the registry
+        size_t options;         //!< Option objects
+        size_t descriptions;    //!< Heap bytes of the option descriptions
+        size_t string_values;   //!< Heap bytes of the option values (eg. std::string)
+        size_t snapshots;       //!< NUMA replicas of the published values
+        size_t history;         //!< Replaced replicas and string values, kept alive for concurrent readers
+
+        size_t total() const { return registry + keys + options + descriptions + string_values + snapshots + history; }
+    };
+
+
+    /*!
+     * \brief Facts about the machine (and the container) the process runs on, to compute option defaults
+     *
+     * Facts that cannot be read are 0. See incfg::hardware.
+     */
+    struct Hardware
+    {
+        unsigned int online_cpus;           //!< Online CPUs
+        unsigned int available_cpus;        //!< CPUs the process may run on (its affinity mask)
+        double cpu_quota;                   //!< CPUs allowed by the cgroup CPU quota (0 if unlimited)
+        unsigned long long memory;          //!< Physical memory, in bytes
+        unsigned long long memory_limit;    //!< cgroup memory limit, in bytes (0 if unlimited)
+        unsigned long long l2_cache;        //!< L2 cache of the first CPU, in bytes
+        unsigned long long l3_cache;        //!< L3 cache of the first CPU, in bytes
+        unsigned long long page_size;       //!< Memory page size, in bytes
+
+        /*!
+         * \brief returns the CPUs the process can keep busy: the available CPUs, capped by the CPU quota (at least 1)
+         */
+        unsigned int cpus() const
+        {
+            unsigned int n = available_cpus ? available_cpus : online_cpus;
+            if( cpu_quota > 0 && cpu_quota < n )
+                n = static_cast< unsigned int >( cpu_quota + 0.999 );
+            return n ? n : 1;
+        }
+
+        /*!
+         * \brief returns the memory the process can use: the physical memory, capped by the cgroup limit
+         */
+        unsigned long long usable_memory() const
+        {
+            return memory_limit && ( !memory || memory_limit < memory ) ? memory_limit : memory;
+        }
+    };
+
+
+    /*!
+     * \brief returns the facts about the machine, probed once on first use
+     *
+     * Meant for option defaults, which are evaluated when the options are registered, so the
+     * configuration generated by ConfigOptions::to_config_string() shows the computed values
+     * and loads override them as usual:
+     *
+     * ```
+     * INCFG_REQUIRE( unsigned int, THREADS, incfg::hardware().cpus(), "Worker threads (default: the usable CPUs)" )
+     * ```
+     */
+    INCFG_INLINE const Hardware& hardware();
+
+
+    /*!
+     * \brief Probes the machine facts, reading the procfs, sysfs and cgroup files under root ("" for the running system)
+     */
+    INCFG_INLINE Hardware probe_hardware( const std::string& root );
+
+
+    /*!
+     * \brief ConfigOptions Class collects and manages all the required key-value pairs
+     *
+     * ConfigOptions is the main class used by incfg to manage all the required key-value pairs.
+     * Before the execution of main(), all the REQUIRED configuration options (defined via INCFG_REQUIRE macro)
+     * are automatically collected via ConfigOptions singleton class and initialized with their default value and
+     * description.
+     *
+     * When your program is running, a single ConfigOptions instance is available to serve the following
+     * two main tasks:
+     *
+     * 1. Generate a configuration string, that can be further written on a text file
+     *
+     * 2. Load configuration options from different sources like an std::string, std::istream or
+     *    program input arguments (*argv[], argc)
+     *
+     * Additionally, ConfigOptions is internally used by the type-safe macro INCFG_GET( key ) to retrieve the
+     * value of a configuration option given its key. The existence of a configuration option given its key
+     * is guaranteed at compile time.
+     *
+     */
+    class ConfigOptions
+    {
+    public:
+
+        /*!
+         * \return A reference of the singleton ConfigOptions object.
+         *
+         * The singleton is an inline variable initialized at compile time, so it can be used during
+         * the static initialization of any translation unit without a function-local static guard.
+         */
+        static inline ConfigOptions& instance() { return singleton; }
+
+
+        /*!
+         * \brief Registers a new option
+         *
+         * A std::logic_error is thrown if a different option has already been registered with the same name.
+         */
+        void add_option( Option* opt );
+
+
+        /*!
+         * \brief Checks that the option registered as name has the type identified by type_id (See Option::type_id)
+         *
+         * INCFG_REQUIRE defines a single option object shared by all the translation units requiring the key,
+         * so it is registered once. With INCFG_CHECK_TYPES defined, each translation unit calls check_type, and
+         * a std::logic_error is thrown if the key is required with different types. Options registered more than
+         * once (eg. declared directly) are always checked by their registration.
+         */
+        bool check_type( const char* name, const void* type_id );
+
+
+        /*!
+         * \brief Allocates the bit of a bool option in the packed flag words, and returns its word
+         *
+         * Flags are allocated in registration order, 64 per word: each word is published (and replicated)
+         * as a whole, so a publication flipping many flags stores a few words.
+         */
+        std::atomic< unsigned long long >* allocate_flag( bool value, unsigned long long& mask, size_t& slot );
+
+
+        /*!
+         * \brief Returns the ```Option``` interface to a given option key (or NULL if no such option exists)
+         * \param name option name (key)
+         */
+        Option* get( const std::string& name ) const;
+
+
+        /*!
+         * \brief Loads configuration options from an input stream
+         * \param _isr Input stream
+         */
+        void load( std::istream& _isr);
+
+
+        /*!
+         * \brief Loads configuration options from an std::string
+         * \param _str configuration string
+         */
+        void load( std::string& _str );
+
+
+        /*!
+         * \brief Loads configuration options from the command line
+         */
+        void load( int argc, char* argv[] );
+
+
+        /*!
+         * \brief Loads configuration options from a file descriptor (eg. a pipe or stdin) until end of file
+         *
+         * Data is read in large blocks and parsed with a Parser, so memory use does not depend on the
+         * input size, and the values are published as a single version at end of file (See Parser).
+         * Only available on POSIX systems.
+         * \param max_line_length Lines longer than this are an Errc::line_too_long error (0: unbounded)
+         */
+        void load_fd( int fd, size_t max_line_length = INCFG_MAX_LINE_LENGTH );
+
+
+        /*!
+         * \brief Non-throwing variants of the loaders: the first error stops the load and is returned
+         *
+         * The values are published together once the whole input is parsed, so nothing is applied if an
+         * error occurs. The throwing loaders are built on these.
+         */
+        Status try_load( std::istream& _isr );
+        Status try_load( const std::string& _str );
+        Status try_load( int argc, char* argv[] );
+        Status try_load_fd( int fd, size_t max_line_length = INCFG_MAX_LINE_LENGTH );
+
+
+        /*!
+         * \brief returns a configuration string for the currently required list of options
+         */
+        std::string to_config_string() const;
+
+
+        /*!
+         * \brief Writes the current configuration as a compact JSON object to a Sink
+         *
+         * Numbers are written unquoted, booleans as ```true```/```false``` literals and
+         * strings (or any other type) as escaped JSON strings. Non-finite real values are written as ```null```.
+         */
+        void to_json( Sink& out ) const;
+
+
+        /*!
+         * \brief returns the current configuration as a compact JSON object
+         */
+        std::string to_json() const;
+
+
+        /*!
+         * \brief Writes the current configuration in the incfg binary format to a Sink
+         *
+         * All integers are little-endian. The dump starts with the 6 bytes ```INCFGB```, a format version
+         * byte (1) and the u32 number of options. Each option follows as: u16 key length, key bytes,
+         * u8 flags (bit 0 set if the option has its default value), u8 type tag and the value:
+         *
+         * - tag 0 (bool): u8
+         * - tag 1 (signed integer): i64
+         * - tag 2 (unsigned integer): u64
+         * - tag 3 (real): IEEE-754 f64
+         * - tag 4 (string or any other type): u32 length, bytes
+         *
+         * A std::length_error is thrown if a key is longer than 65535 bytes (before anything is written) or
+         * a value longer than 4 GiB - 1 (the output is then truncated at that option).
+         */
+        void to_binary( Sink& out ) const;
+
+
+        /*!
+         * \brief returns the current configuration in the incfg binary format (See ```to_binary( Sink& )```)
+         */
+        std::string to_binary() const;
+
+
+        /*!
+         * \brief Writes a C++ header freezing the current value of the options to a Sink
+         *
+         * Each option of a fundamental arithmetic type (or bool) gets an incfg::Frozen specialization
+         * holding its current value as a compile-time constant. Compiling a program with
+         * ```-DINCFG_FROZEN_CONFIG='"header.hpp"'``` makes ```INCFG_GET()``` return these constants, so
+         * the compiler can fold them. Options of other types keep working as usual.
+         */
+        void to_frozen_header( Sink& out ) const;
+
+
+        /*!
+         * \brief returns a C++ header freezing the current value of the options (See ```to_frozen_header( Sink& )```)
+         */
+        std::string to_frozen_header() const;
+
+
+        /*!
+         * \brief returns the number of currenlty managed configuration options
+         */
+        size_t size() const;
+
+
+        /*!
+         * \brief option_by_index returns the idx^th configuration option
+         * \param idx index (0..size()-1) of the configuration option
+         */
+        Option* option_by_index( size_t idx ) const;
+
+
+        /*!
+         * \brief returns the memory used by the configuration
+         *
+         * Computed in constant time from counters updated when options are registered, string values
+         * change and replicas are allocated. Heap bytes of std::string objects fitting in their
+         * internal buffer are not counted.
+         */
+        MemoryUsage memory_usage() const;
+
+
+        /*!
+         * \brief Accounts for a change of the heap bytes held by an option value (within a Publication)
+         */
+        void account_value_bytes( size_t old_bytes, size_t new_bytes );
+
+
+        /*!
+         * \brief returns a file descriptor that becomes readable when a version changing one of the given options is published
+         *
+         * Meant for event loops (epoll, poll, select): when the descriptor is readable, the loop calls
+         * ```fetch_changes()``` on its own thread to get the options changed since its last call, which
+         * also rearms the descriptor. The publishing thread only writes to the descriptor when it
+         * becomes readable. On Linux the descriptor is an eventfd, elsewhere the read end of a pipe
+         * (only POSIX systems are supported).
+         *
+         * \param keys keys of the options of interest (all the options if empty). A std::invalid_argument
+         *        is thrown if a key does not exist.
+         */
+        int notification_fd( std::initializer_list< const char* > keys = std::initializer_list< const char* >() );
+
+
+        /*!
+         * \brief Closes a descriptor returned by notification_fd
+         */
+        void close_notification_fd( int fd );
+
+
+        /*!
+         * \brief Calls ```visitor( Option& )``` for each option changed since the last call for a notification descriptor
+         * \return the number of changed options
+         */
+        template <typename F>
+        size_t fetch_changes( int fd, F visitor ) { return fetch_changes( fd, &detail::visit_change< F >, &visitor ); }
+
+        size_t fetch_changes( int fd, void (*visit)( Option&, void* ), void* visitor );
+
+
+        /*!
+         * \brief Seals the configuration: options can no longer be set, loaded or registered
+         *
+         * Meant to be called once the startup configuration is loaded. Afterwards INCFG_SET and load()
+         * throw a std::logic_error if they change a value (setting the current value is accepted), and so
+         * do registrations, so the values never change again: options of any type (not only the published
+         * ones) can then be read from any thread without synchronization. A rejected load applies nothing.
+         */
+        void seal();
+
+
+        /*!
+         * \brief Seals startup-only options individually, the others can still be changed at runtime
+         *
+         * A std::invalid_argument is thrown if a key does not exist.
+         */
+        void seal( std::initializer_list< const char* > keys );
+
+
+        /*!
+         * \brief returns true if the whole configuration is sealed
+         */
+        inline bool is_sealed() const { return sealed.load( std::memory_order_acquire ); }
+
+
+        /*!
+         * \brief returns false if an option is sealed (checked by its setters within a Publication)
+         */
+        inline bool is_writable( const Option& opt ) const { return !opt.sealed && !is_sealed(); }
+
+
+        /*!
+         * \brief Registers a function called with ```context``` at the end of each publication changing options
+         *
+         * Listeners are called on the publishing thread while the publication lock is held: they must
+         * neither block nor publish. They are meant to derive state from the new version (See Multiversion).
+         */
+        void add_listener( void (*listener)( void* ), void* context );
+
+
+        /*!
+         * \brief Unregisters a function registered by add_listener
+         */
+        void remove_listener( void (*listener)( void* ), void* context );
+
+
+        /*!
+         * \brief Records an option as changed by the current Publication (See notification_fd)
+         */
+        void changed( Option& opt );
+
+
+        /*!
+         * \brief Scope of a publication: the options set while it exists are published as a single new version
+         *
+         * Publications are serialized by a (recursive) writer lock and can be nested, in which case only the
+         * outermost one publishes a new version. TypedOption::set opens one implicitly.
+         */
+        class Publication
+        {
+        public:
+            explicit Publication( ConfigOptions& _co ) : co( _co ) { co.begin_publication(); }
+            ~Publication() { co.end_publication(); }
+
+        private:
+            Publication( const Publication& other );
+            Publication& operator=( const Publication& other );
+            ConfigOptions& co;
+        };
+
+
+        /*!
+         * \brief Holds the writer lock without publishing a version: no publication can happen in its scope
+         */
+        class WriterLock
+        {
+        public:
+            explicit WriterLock( ConfigOptions& _co ) : co( _co ) { co.lock_writers(); }
+            ~WriterLock() { co.unlock_writers(); }
+
+        private:
+            WriterLock( const WriterLock& other );
+            WriterLock& operator=( const WriterLock& other );
+            ConfigOptions& co;
+        };
+
+
+        /*!
+         * \brief returns the number of versions published so far
+         *
+         * Options of trivially copyable types fitting in 64 bits (numbers, bool, durations, etc.) and
+         * std::string options are *published*: their value lives in an atomic word, so they can be set
+         * while other threads read them. Every Publication increments the version. Options of other
+         * types are not synchronized and must not be set while being read.
+         */
+        inline unsigned long long version() const { return sequence.load( std::memory_order_acquire ) / 2; }
+
+
+        /*!
+         * \brief Keeps one replica of the published values on each NUMA node
+         *
+         * Once enabled, reads of published options are served by the replica allocated on the NUMA node of
+         * the reading thread, and every publication updates all the replicas. This avoids pulling the
+         * values across sockets after each reload.
+         *
+         * The node of a thread is looked up the first time it reads a published option (See
+         * refresh_thread_node). On Linux, the topology is read from /sys/devices/system/node and each
+         * replica is bound to its node with mbind(2). Elsewhere a single node is assumed.
+         *
+         * \param emulated_nodes If not zero, ignores the actual topology and splits the CPUs evenly in
+         *        the given number of nodes (replicas are not bound to any node in this case)
+         */
+        void enable_numa_replicas( unsigned int emulated_nodes = 0 );
+
+
+        /*!
+         * \brief returns the number of NUMA replicas of the published values (0 if replicas are not enabled)
+         */
+        unsigned int numa_replicas() const;
+
+
+        /*!
+         * \brief Looks up again the NUMA node of the calling thread (eg. after changing its CPU affinity)
+         */
+        void refresh_thread_node();
+
+
+        /*!
+         * \brief returns the replica of the published values for the calling thread, or NULL if replicas are not enabled
+         */
+        inline const std::atomic< unsigned long long >* local_replica() const
+        {
+            if( !numa_enabled.load( std::memory_order_relaxed ) )
+                return 0;
+
+            if( thread_node < 0 )
+                thread_node = lookup_thread_node();
+
+            return replicas[ thread_node ].load( std::memory_order_acquire );
+        }
+
+
+        /*!
+         * \brief Stores the bits of a published option in its word and in every replica (within a Publication)
+         */
+        void store_published( Option& opt, unsigned long long bits );
+
+
+        /*!
+         * \brief Keeps a replaced published value (eg. a std::string copy) alive while readers may reference it
+         *
+         * The value is freed by a later publication, once every read section that may reference it
+         * has ended (See ReadSection). Its bytes are accounted as history until then (See memory_usage).
+         */
+        void retire_published( unsigned long long bits, void (*release)( unsigned long long ), size_t bytes );
+
+
+        /*!
+         * \brief Scope within which the calling thread may reference published std::string values
+         *
+         * Values replaced by a publication are not freed before the read sections started before it
+         * end. The std::string getters copy the value out of their own section: only the values
+         * read with get_consistent( section, ... ) are references, valid until the section ends.
+         * Sections can be nested. Threads beyond INCFG_MAX_READER_THREADS hold the writer lock
+         * instead, so sections must stay short.
+         */
+        class ReadSection
+        {
+        public:
+            explicit ReadSection( ConfigOptions& _co = ConfigOptions::instance() ) : co( _co ), mode( co.pin_reader() ) {}
+            ~ReadSection() { co.unpin_reader( mode ); }
+
+        private:
+            ReadSection( const ReadSection& other );
+            ReadSection& operator=( const ReadSection& other );
+            ConfigOptions& co;
+            const int mode;
+        };
+
+
+        /*!
+         * \brief Starts a consistent read of published values: returns the current (even) sequence
+         *
+         * Values read after read_begin() belong to the same version if read_retry() returns false.
+         */
+        inline unsigned long long read_begin() const
+        {
+            unsigned long long seq = sequence.load( std::memory_order_acquire );
+            while( seq & 1 )
+                seq = sequence.load( std::memory_order_acquire );
+            return seq;
+        }
+
+
+        /*!
+         * \brief returns true if a publication happened since read_begin() returned seq
+         */
+        inline bool read_retry( unsigned long long seq ) const
+        {
+            std::atomic_thread_fence( std::memory_order_acquire );
+            return sequence.load( std::memory_order_relaxed ) != seq;
+        }
+
+
+    private:
+        constexpr ConfigOptions() : sequence( 0 ), sealed( false ), numa_enabled( false ), replicas(), reclaim_epoch( 0 ),
+                                    readers_used( 0 ), readers() {}
+        ConfigOptions( const ConfigOptions& other );
+        ConfigOptions& operator=( const ConfigOptions& other );
+        static ConfigOptions singleton;
+        struct Registry;
+        Registry& get_registry() const;
+        void begin_publication();
+        void end_publication();
+        void lock_writers();
+        void unlock_writers();
+        int lookup_thread_node() const;
+        void grow_replicas( size_t capacity );
+        size_t publish_word( std::atomic< unsigned long long >* word );
+        std::atomic< unsigned long long >* register_reader();
+        void reclaim_retired();
+
+        // Read section modes (See ReadSection)
+        enum { NESTED_READER, PINNED_READER, LOCKED_READER };
+
+        inline int pin_reader()
+        {
+            if( reader_pinned )
+                return NESTED_READER;
+
+            std::atomic< unsigned long long >* slot = reader_slot ? reader_slot : register_reader();
+            reader_pinned = true;
+            if( !slot )
+            {
+                // No free slot: exclude writers instead, so nothing read can be retired meanwhile
+                lock_writers();
+                reader_locked = true;
+                return LOCKED_READER;
+            }
+            slot->store( reclaim_epoch.load( std::memory_order_acquire ) + SLOT_PINNED, std::memory_order_relaxed );
+            std::atomic_thread_fence( std::memory_order_seq_cst );
+            return PINNED_READER;
+        }
+
+        inline void unpin_reader( int mode )
+        {
+            if( mode == NESTED_READER )
+                return;
+
+            reader_pinned = false;
+            if( mode == LOCKED_READER )
+            {
+                reader_locked = false;
+                unlock_writers();
+            }
+            else if( reader_slot )
+            {
+                reader_slot->store( SLOT_IDLE, std::memory_order_release );
+            }
+        }
+
+        // Seqlock sequence: odd while a publication is in progress
+        std::atomic< unsigned long long > sequence;
+
+        std::atomic< bool > sealed;
+        std::atomic< bool > numa_enabled;
+        std::atomic< const std::atomic< unsigned long long >* > replicas[ INCFG_MAX_NUMA_NODES ];
+        static inline thread_local int thread_node = -1;
+
+        // Epoch-based reclamation of retired string values (See ReadSection): each reader thread owns
+        // a slot holding SLOT_IDLE, or the epoch its section started in plus SLOT_PINNED (0 if free).
+        // A thread finding no free slot holds the writer lock during its sections (reader_locked).
+        static const unsigned long long SLOT_IDLE = 1;
+        static const unsigned long long SLOT_PINNED = 2;
+        struct alignas( 64 ) ReaderSlot
+        {
+            std::atomic< unsigned long long > state;
+        };
+        std::atomic< unsigned long long > reclaim_epoch;
+        std::atomic< size_t > readers_used;
+        ReaderSlot readers[ INCFG_MAX_READER_THREADS ];
+        static inline thread_local std::atomic< unsigned long long >* reader_slot = 0;
+        static inline thread_local bool reader_pinned = false;
+        static inline thread_local bool reader_locked = false;
+    };
+
+
+    inline ConfigOptions ConfigOptions::singleton;
+
+
+    /*!
+     * \brief Storage of a configuration option of type T (See INCFG_REQUIRE)
      *
-     * When your program is running, a single ConfigOptions instance is available to serve the following
-     * two main tasks:
+     * INCFG_REQUIRE defines each TypedOption as an inline variable, so the same option required in
+     * more than one translation unit refers to a single object that INCFG_GET reads directly.
+     */
+    template <typename T>
+    class TypedOption : public Option
+    {
+    public:
+        typedef T value_type;
+
+        /*!
+         * \param frozen_value If not NULL, the value the option is frozen to (See incfg::Frozen)
+         */
+        TypedOption( const char* _name, const T& default_value, const char* _description, const T* frozen_value = 0 );
+        ~TypedOption();
+
+        Status try_parse_value_from_str( const std::string& str );
+        Status try_stage_value_from_str( const std::string& str, Batch& batch );
+        std::string get_value_as_str() const;
+        void write_value( ValueWriter& w ) const;
+
+        inline bool is_default() const { return is_def; }
+        inline bool is_bool() const { return std::is_same< T, bool >::value; }
+        inline bool is_frozen() const { return frozen; }
+        inline const char* type_name() const { return TypeName< T >::value; }
+        inline size_t object_size() const { return sizeof( *this ); }
+        size_t value_heap_bytes() const;
+
+        /*!
+         * \brief returns the option value (by value for published types, See ConfigOptions::version)
+         *
+         * std::string values are copied out of a ConfigOptions::ReadSection.
+         */
+        inline decltype(auto) get() const
+        {
+            if constexpr ( detail::Published< T >::owns_memory )
+            {
+                const ConfigOptions::ReadSection section;
+                return T( read() );
+            }
+            else
+            {
+                return read();
+            }
+        }
+
+        /*!
+         * \brief Reads a published value from a given replica (or from the option itself if NULL)
+         *
+         * std::string values are returned by reference: only within a ConfigOptions::ReadSection.
+         */
+        inline typename detail::Published< T >::read_type read_published( const std::atomic< unsigned long long >* replica ) const
+        {
+            if( replica )
+                return value.decode( replica[ slot ].load( detail::Published< T >::load_order ) );
+            return value.load();
+        }
+
+        inline void set( const T& new_value )
+        {
+            try_set( new_value ).raise();
+        }
+
+        /*!
+         * \brief Non-throwing set(): an Errc::sealed error if the option is sealed and the value differs
+         *
+         * Setting the current value succeeds, even on a sealed option, and publishes nothing.
+         */
+        Status try_set( const T& new_value );
+
+        /*!
+         * \brief returns the error set( new_value ) would fail with, without setting the option
+         */
+        Status check_set( const T& new_value ) const;
+
+    private:
+        template <size_t N> friend class FlagSet;
+
+        // Reads the value without copying it: published strings only within a ConfigOptions::ReadSection
+        inline decltype(auto) read() const
+        {
+            if constexpr ( detail::is_published< T >::value )
+                return read_published( ConfigOptions::instance().local_replica() );
+            else
+                return value.load();
+        }
+
+        inline Status sealed_error() const
+        {
+            return Status( Errc::sealed, 0, "Option " + name + " is sealed" );
+        }
+
+        // Parses a new value and passes it to apply, unless it is invalid or changes a frozen option
+        template <typename F>
+        Status parse_and_apply( const std::string& str, F apply );
+
+        detail::OptionValue< T > value;
+        bool is_def;
+        bool frozen;
+    };
+
+
+    /*
+     * The members of TypedOption off the read path are defined out of the class, so the options of the
+     * fundamental types are instantiated once in incfg.cpp (See INCFG_EXTERN_TYPED_OPTION).
+     */
+    template <typename T>
+    TypedOption< T >::TypedOption( const char* _name, const T& default_value, const char* _description, const T* frozen_value )
+        : Option( _name, _description, &detail::TypeId< T >::id ), value( frozen_value ? *frozen_value : default_value ),
+          is_def( !frozen_value || *frozen_value == default_value ), frozen( frozen_value!=0 )
+    {
+        if constexpr ( std::is_same< T, bool >::value )
+            value.flags = ConfigOptions::instance().allocate_flag( frozen_value ? *frozen_value : default_value, value.mask, slot );
+        word = value.word();
+        ConfigOptions::instance().add_option( this );
+    }
+
+
+    template <typename T>
+    TypedOption< T >::~TypedOption() {}
+
+
+    template <typename T>
+    Status TypedOption< T >::try_parse_value_from_str( const std::string& str )
+    {
+        return parse_and_apply( str, [this]( const T& new_value ) { return try_set( new_value ); } );
+    }
+
+
+    template <typename T>
+    std::string TypedOption< T >::get_value_as_str() const
+    {
+        const ConfigOptions::ReadSection section;
+        return to_string_helper< T >( read() );
+    }
+
+
+    template <typename T>
+    void TypedOption< T >::write_value( ValueWriter& w ) const
+    {
+        const ConfigOptions::ReadSection section;
+        incfg::write_value( w, read() );
+    }
+
+
+    template <typename T>
+    size_t TypedOption< T >::value_heap_bytes() const
+    {
+        const ConfigOptions::ReadSection section;
+        if constexpr ( detail::Published< T >::owns_memory )
+            return sizeof( T ) + detail::heap_bytes( read() );
+        else
+            return detail::heap_bytes( read() );
+    }
+
+
+    template <typename T>
+    Status TypedOption< T >::try_set( const T& new_value )
+    {
+        ConfigOptions& co = ConfigOptions::instance();
+        ConfigOptions::WriterLock lock( co );
+
+        // Read directly: values are not retired while the writer lock is held
+        if( new_value == value.load() )
+            return Status();
+        if( !co.is_writable( *this ) )
+            return sealed_error();
+
+        ConfigOptions::Publication publication( co );
+        is_def = false;
+        const size_t old_bytes = value_heap_bytes();
+        if constexpr ( detail::is_published< T >::value )
+        {
+            const unsigned long long old_bits = word->load( std::memory_order_relaxed );
+            co.store_published( *this, value.encode( new_value ) );
+            if constexpr ( detail::Published< T >::owns_memory )
+                co.retire_published( old_bits, &detail::Published< T >::release, old_bytes );
+        }
+        else
+        {
+            value.store( new_value );
+        }
+        co.account_value_bytes( old_bytes, value_heap_bytes() );
+        changes.store( changes.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+        co.changed( *this );
+        return Status();
+    }
+
+
+    template <typename T>
+    Status TypedOption< T >::check_set( const T& new_value ) const
+    {
+        const ConfigOptions::ReadSection section;
+        if( ConfigOptions::instance().is_writable( *this ) || new_value == read() )
+            return Status();
+        return sealed_error();
+    }
+
+
+    template <typename T>
+    template <typename F>
+    Status TypedOption< T >::parse_and_apply( const std::string& str, F apply )
+    {
+        const ConfigOptions::ReadSection section;
+        const T current = read();
+        const Expected< T > new_value = incfg::parse_value< T >( str, current );
+        if( !new_value )
+            return Status( Errc::invalid_value, 0, new_value.error() );
+
+        if( frozen && !(*new_value == current) )
+            return Status( Errc::frozen, 0, "Option " + name + " is frozen to " + get_value_as_str() + " in this build" );
+
+        return apply( *new_value );
+    }
+
+
+    /*!
+     * \brief Compile-time value of a frozen option
      *
-     * 1. Generate a configuration string, that can be further written on a text file
+     * Specialized by the header generated by ConfigOptions::to_frozen_header for the tag type declared by
+     * INCFG_REQUIRE. A specialization has ```value``` set to true and a constexpr ```frozen_value``` member.
+     */
+    template <typename TAG>
+    struct Frozen { static constexpr bool value = false; };
+
+
+    template <typename TAG, typename T>
+    constexpr const T* frozen_value()
+    {
+        if constexpr ( Frozen< TAG >::value )
+            return &Frozen< TAG >::frozen_value;
+        else
+            return 0;
+    }
+
+
+    template <typename TAG, typename T>
+    constexpr decltype(auto) get_option( const TypedOption< T >& opt )
+    {
+        if constexpr ( Frozen< TAG >::value )
+            return static_cast< T >( Frozen< TAG >::frozen_value );
+        else
+            return opt.get();
+    }
+
+
+    template <typename TAG, typename T>
+    inline void set_option( TypedOption< T >& opt, const typename TypedOption< T >::value_type& new_value )
+    {
+        static_assert( !Frozen< TAG >::value, "INCFG_SET used on an option frozen by INCFG_FROZEN_CONFIG" );
+        opt.set( new_value );
+    }
+
+
+    /*!
+     * \brief Options sets staged together and published as a single version
+     *
+     * Unlike a ConfigOptions::Publication, a Batch does not hold the publication lock while values are
+     * staged: commit() applies them all at once, with one version bump, one call of the listeners and
+     * one notification. An option staged again keeps only its last value, so the memory of a batch is
+     * bounded by the number of options. Staged sets not committed are discarded by the destructor.
+     *
+     * ```
+     * incfg::Batch batch;
+     * INCFG_BATCH_SET( batch, BUFFER_SIZE, 8192 );
+     * INCFG_BATCH_SET( batch, DEBUG_LOG, true );
+     * batch.commit();
+     * ```
+     */
+    class Batch
+    {
+    public:
+        Batch() : first( 0 ), last( 0 ), count( 0 ), index( 0 ) {}
+        ~Batch() { clear(); }
+
+        /*!
+         * \brief Stages a new value for an option (See INCFG_BATCH_SET, TAG is void for options declared
+         * without INCFG_REQUIRE, eg. incfg::Required)
+         */
+        template <typename TAG = void, typename T>
+        inline void set( TypedOption< T >& opt, const typename TypedOption< T >::value_type& new_value )
+        {
+            static_assert( !Frozen< TAG >::value, "INCFG_BATCH_SET used on an option frozen by INCFG_FROZEN_CONFIG" );
+            Staged*& staged = staged_value( opt );
+            if( staged )
+                static_cast< StagedValue< T >* >( staged )->value = new_value;
+            else
+                stage( staged = new StagedValue< T >( opt, new_value ) );
+        }
+
+        /*!
+         * \brief Publishes the staged values as a single version, in the order the options were first
+         * staged (nothing if empty)
+         */
+        void commit() { try_commit().raise(); }
+
+        /*!
+         * \brief Non-throwing commit(): the first error is returned, and nothing is applied then (eg. if a
+         * staged value changes a sealed option). The staged values are discarded in any case.
+         */
+        Status try_commit()
+        {
+            Status status;
+            if( !first )
+                return status;
+            {
+                // All the values are checked before the publication starts, with no writer in between
+                ConfigOptions& co = ConfigOptions::instance();
+                ConfigOptions::WriterLock lock( co );
+                for( Staged* staged=first; staged && status; staged=staged->next )
+                    status = staged->check();
+
+                if( status )
+                {
+                    ConfigOptions::Publication publication( co );
+                    for( Staged* staged=first; staged && status; staged=staged->next )
+                        status = staged->apply();
+                }
+            }
+            clear();
+            return status;
+        }
+
+        /*!
+         * \brief Discards the staged values
+         */
+        void clear();
+
+        /*!
+         * \brief returns the number of options staged
+         */
+        inline size_t size() const { return count; }
+
+    private:
+        Batch( const Batch& other );
+        Batch& operator=( const Batch& other );
+
+        struct Staged
+        {
+            Staged() : next( 0 ) {}
+            virtual ~Staged() {}
+            virtual Status check() const = 0;
+            virtual Status apply() = 0;
+            Staged* next;
+        };
+
+        template <typename T>
+        struct StagedValue : public Staged
+        {
+            StagedValue( TypedOption< T >& _opt, const T& _value ) : opt( _opt ), value( _value ) {}
+            Status check() const { return opt.check_set( value ); }
+            Status apply() { return opt.try_set( value ); }
+            TypedOption< T >& opt;
+            T value;
+        };
+
+        // Staged value of each option (defined in incfg.cpp): the entry of opt, NULL if not staged yet
+        struct Index;
+        Staged*& staged_value( const Option& opt );
+
+        void stage( Staged* staged )
+        {
+            if( last )
+                last->next = staged;
+            else
+                first = staged;
+            last = staged;
+            ++count;
+        }
+
+        Staged* first;
+        Staged* last;
+        size_t count;
+        Index* index;
+    };
+
+
+    template <typename T>
+    Status TypedOption< T >::try_stage_value_from_str( const std::string& str, Batch& batch )
+    {
+        return parse_and_apply( str, [this, &batch]( const T& new_value )
+        {
+            // Checked again when the batch is committed
+            const Status status = check_set( new_value );
+            if( status )
+                batch.set( *this, new_value );
+            return status;
+        } );
+    }
+
+
+#ifndef INCFG_HEADER_ONLY
+    // Options of the published fundamental types are instantiated once in incfg.cpp (See INCFG_DEFINE_TYPED_OPTION)
+#define INCFG_EXTERN_TYPED_OPTION( TYPE ) \
+    extern template class TypedOption< TYPE >;
+
+    INCFG_EXTERN_TYPED_OPTION( bool )
+    INCFG_EXTERN_TYPED_OPTION( char )
+    INCFG_EXTERN_TYPED_OPTION( signed char )
+    INCFG_EXTERN_TYPED_OPTION( unsigned char )
+    INCFG_EXTERN_TYPED_OPTION( short )
+    INCFG_EXTERN_TYPED_OPTION( unsigned short )
+    INCFG_EXTERN_TYPED_OPTION( int )
+    INCFG_EXTERN_TYPED_OPTION( unsigned int )
+    INCFG_EXTERN_TYPED_OPTION( long )
+    INCFG_EXTERN_TYPED_OPTION( unsigned long )
+    INCFG_EXTERN_TYPED_OPTION( long long )
+    INCFG_EXTERN_TYPED_OPTION( unsigned long long )
+    INCFG_EXTERN_TYPED_OPTION( float )
+    INCFG_EXTERN_TYPED_OPTION( double )
+    INCFG_EXTERN_TYPED_OPTION( std::string )
+#endif
+
+
+    /*!
+     * \brief Incremental (push) parser of the configuration text format
+     *
+     * Chunks of any size are passed to ```feed()``` as they are received, and each value is parsed and
+     * staged as soon as its line is complete. Complete lines are tokenized directly from the chunk; only
+     * the last, incomplete line of a chunk is copied and kept until the next one. ```finish()``` parses
+     * the last line if the input does not end with a newline and publishes the staged values as a
+     * single version (See Batch), so readers never see a partly applied configuration.
+     *
+     * ```
+     * incfg::Parser parser;
+     * while( ( len = receive( buffer, sizeof(buffer) ) ) > 0 )
+     *     parser.feed( buffer, len );
+     * parser.finish();
+     * ```
+     *
+     * Errors are reported as by ```ConfigOptions::load()```, or returned by ```try_feed()``` and
+     * ```try_finish()```, and discard the staged values. A parser that failed must not be fed again.
+     */
+    class Parser
+    {
+    public:
+        /*!
+         * \param _max_line_length Lines longer than this are an Errc::line_too_long error, bounding the
+         *        memory used for an incomplete line (0: unbounded, eg. for an input already in memory)
+         */
+        explicit Parser( ConfigOptions& _co = ConfigOptions::instance(), size_t _max_line_length = INCFG_MAX_LINE_LENGTH );
+
+        /*!
+         * \brief Parses a chunk of input, staging the values of the lines it completes
+         */
+        void feed( const char* data, size_t len ) { try_feed( data, len ).raise(); }
+
+        /*!
+         * \brief Parses the remaining incomplete line (if any) and publishes the staged values. The parser
+         * can then be reused for a new input.
+         */
+        void finish() { try_finish().raise(); }
+
+        /*!
+         * \brief Non-throwing feed(): returns the first error of the chunk
+         */
+        Status try_feed( const char* data, size_t len );
+
+        /*!
+         * \brief Non-throwing finish()
+         */
+        Status try_finish();
+
+        /*!
+         * \brief returns the number of complete lines parsed so far
+         */
+        size_t lines() const { return linenum; }
+
+    private:
+        Status parse_line( const char* begin, const char* end );
+
+        ConfigOptions& co;
+        const size_t max_line_length;
+        size_t linenum;
+        std::string partial;
+        std::string value;
+        Batch batch;
+    };
+
+
+    /*!
+     * \brief Reference to an option together with its tag, so that frozen options read as constants (See INCFG_OPTION)
+     */
+    template <typename TAG, typename T>
+    struct OptionRef
+    {
+        const TypedOption< T >& opt;
+
+        inline decltype(auto) read( const std::atomic< unsigned long long >* replica ) const
+        {
+            if constexpr ( Frozen< TAG >::value )
+                return static_cast< T >( Frozen< TAG >::frozen_value );
+            else
+                return opt.read_published( replica );
+        }
+    };
+
+
+    template <typename TAG, typename T>
+    constexpr OptionRef< TAG, T > option_ref( const TypedOption< T >& opt )
+    {
+        return OptionRef< TAG, T >{ opt };
+    }
+
+
+    namespace detail
+    {
+        // Reads the options into a TUPLE of values or references, retrying until they belong to the same version
+        template <typename TUPLE, typename... TAGS, typename... TS>
+        inline TUPLE read_consistent( const OptionRef< TAGS, TS >&... refs )
+        {
+            static_assert( ( is_published< TS >::value && ... ), "get_consistent requires published option types" );
+
+            const ConfigOptions& co = ConfigOptions::instance();
+            const std::atomic< unsigned long long >* replica = co.local_replica();
+            for( ;; )
+            {
+                const unsigned long long seq = co.read_begin();
+                TUPLE values( refs.read( replica )... );
+                if( !co.read_retry( seq ) )
+                    return values;
+            }
+        }
+    }
+
+
+    /*!
+     * \brief Reads several options from the same configuration version
      *
-     * 2. Load configuration options from different sources like an std::string, std::istream or
-     *    program input arguments (*argv[], argc)
+     * Returns a std::tuple with the values of the given options (See INCFG_OPTION), all belonging to the
+     * same version even if a reload is published concurrently. Only published option types can be read.
+     * The version is validated with a single sequence check for the whole batch: the values themselves
+     * are plain loads, and std::string values are copied.
      *
-     * Additionally, ConfigOptions is internally used by the type-safe macro INCFG_GET( key ) to retrieve the
-     * value of a configuration option given its key. The existence of a configuration option given its key
-     * is guaranteed at compile time.
+     * ```
+     * auto [host, port, timeout] = incfg::get_consistent( INCFG_OPTION( HOST ), INCFG_OPTION( PORT ), INCFG_OPTION( TIMEOUT ) );
+     * ```
+     */
+    template <typename... TAGS, typename... TS>
+    inline std::tuple< typename std::decay< decltype( std::declval< OptionRef< TAGS, TS > >().read( 0 ) ) >::type... >
+        get_consistent( const OptionRef< TAGS, TS >&... refs )
+    {
+        const ConfigOptions::ReadSection section;
+        return detail::read_consistent< std::tuple< typename std::decay< decltype( refs.read( 0 ) ) >::type... > >( refs... );
+    }
+
+
+    /*!
+     * \brief get_consistent() returning std::string values by const reference, valid until section ends
      *
+     * ```
+     * const incfg::ConfigOptions::ReadSection section;
+     * auto [host, port] = incfg::get_consistent( section, INCFG_OPTION( HOST ), INCFG_OPTION( PORT ) );
+     * ```
      */
-    class ConfigOptions
+    template <typename... TAGS, typename... TS>
+    inline std::tuple< decltype( std::declval< OptionRef< TAGS, TS > >().read( 0 ) )... >
+        get_consistent( const ConfigOptions::ReadSection&, const OptionRef< TAGS, TS >&... refs )
+    {
+        return detail::read_consistent< std::tuple< decltype( refs.read( 0 ) )... > >( refs... );
+    }
+
+
+    /*!
+     * \brief Reads several options declared without INCFG_REQUIRE (eg. incfg::Required) from the same version
+     */
+    template <typename... TS>
+    inline std::tuple< TS... > get_consistent( const TypedOption< TS >&... opts )
+    {
+        return get_consistent( OptionRef< void, TS >{ opts }... );
+    }
+
+
+    /*!
+     * \brief Reads several options declared without INCFG_REQUIRE by reference, valid until section ends
+     */
+    template <typename... TS>
+    inline std::tuple< typename detail::Published< TS >::read_type... > get_consistent( const ConfigOptions::ReadSection& section,
+                                                                                         const TypedOption< TS >&... opts )
+    {
+        return get_consistent( section, OptionRef< void, TS >{ opts }... );
+    }
+
+
+    /*!
+     * \brief Fields of a struct S bound to options with INCFG_BIND, copied together by incfg::refresh
+     */
+    template <typename S>
+    class Binding
     {
     public:
+        typedef void (*Copy)( S& s, const std::atomic< unsigned long long >* replica );
+
+        static Binding& instance() { return table; }
 
         /*!
-         * \return A reference of the singleton ConfigOptions object.
+         * \brief Adds a field to the table (called by INCFG_BIND at static initialization)
+         *
+         * Fields are kept in binding order and live as long as the program.
          */
-        static ConfigOptions& instance();
-
-
-        inline void add_option( Option* opt )
+        bool bind( Copy copy, const Option& opt )
         {
-            if( options.find( opt->name ) == options.end() ) {
-                options[opt->name] = opt;
-            }
+            Field* field = new Field{ copy, &opt, 0 };
+            *last = field;
+            last = &field->next;
+            ++count;
+            return true;
         }
 
-
         /*!
-         * \brief Returns the ```Option``` interface to a given option key
-         * \param name option name (key)
+         * \brief Copies every bound field (See incfg::refresh)
          */
-        inline Option* get( std::string name )  { return options[ name ]; }
+        inline void copy( S& s, const std::atomic< unsigned long long >* replica ) const
+        {
+            for( const Field* field=first; field; field=field->next )
+                field->copy( s, replica );
+        }
 
+        /*!
+         * \brief returns the number of bound fields
+         */
+        inline size_t size() const { return count; }
 
         /*!
-         * \brief Loads configuration options from an input stream
-         * \param _isr Input stream
+         * \brief Calls visitor( const Option& ) for the option of each bound field
          */
-        void load( std::istream& _isr);
+        template <typename F>
+        void for_each_option( F visitor ) const
+        {
+            for( const Field* field=first; field; field=field->next )
+                visitor( *field->opt );
+        }
+
+        template <typename TAG, auto FIELD, auto& OPTION>
+        static void copy_field( S& s, const std::atomic< unsigned long long >* replica )
+        {
+            static_assert( detail::is_published< typename std::remove_reference< decltype( OPTION ) >::type::value_type >::value,
+                           "INCFG_BIND requires published option types" );
+            s.*FIELD = option_ref< TAG >( OPTION ).read( replica );
+        }
 
+    private:
+        constexpr Binding() : first( 0 ), last( &first ), count( 0 ) {}
+        Binding( const Binding& other );
+        Binding& operator=( const Binding& other );
+
+        struct Field
+        {
+            Copy copy;
+            const Option* opt;
+            Field* next;
+        };
+
+        static Binding table;
+
+        Field* first;
+        Field** last;
+        size_t count;
+    };
+
+
+    template <typename S>
+    Binding< S > Binding< S >::table;
+
+
+    namespace detail
+    {
+        // Registration of a field bound by INCFG_BIND, specialized once per field
+        template <auto FIELD>
+        struct FieldBinding
+        {
+            static const bool bound;
+        };
+    }
+
+
+    /*!
+     * \brief Optional base of a bound struct, holding the configuration version it was refreshed to
+     */
+    struct BoundStruct
+    {
+        BoundStruct() : bound_version( ~0ULL ) {}
+        unsigned long long bound_version;
+    };
+
+
+    /*!
+     * \brief Copies the options bound to the fields of s (See INCFG_BIND) if the configuration changed
+     *
+     * version is the configuration version s was last refreshed to (~0ULL if never): nothing is done
+     * if it is still current, otherwise all the fields are copied from the same version in one pass
+     * and version is updated. Returns true if the fields were copied.
+     *
+     * ```
+     * struct Settings { int threads; std::string host; };
+     * INCFG_BIND( Settings, threads, THREADS )
+     * INCFG_BIND( Settings, host, HOST )
+     *
+     * Settings settings;
+     * unsigned long long version = ~0ULL;
+     * incfg::refresh( settings, version );   // eg. once per batch of work
+     * ```
+     */
+    template <typename S>
+    inline bool refresh( S& s, unsigned long long& version )
+    {
+        const ConfigOptions& co = ConfigOptions::instance();
+        if( co.version() == version )
+            return false;
+
+        const ConfigOptions::ReadSection section;
+        const Binding< S >& binding = Binding< S >::instance();
+        const std::atomic< unsigned long long >* replica = co.local_replica();
+        for( ;; )
+        {
+            const unsigned long long seq = co.read_begin();
+            binding.copy( s, replica );
+            if( !co.read_retry( seq ) )
+            {
+                version = seq / 2;
+                return true;
+            }
+        }
+    }
+
+
+    /*!
+     * \brief Refreshes a struct deriving from BoundStruct, which holds its own version
+     */
+    template <typename S>
+    inline bool refresh( S& s )
+    {
+        static_assert( std::is_base_of< BoundStruct, S >::value, "refresh( s ) requires s to derive from incfg::BoundStruct" );
+        return refresh( s, static_cast< BoundStruct& >( s ).bound_version );
+    }
+
+
+    /*!
+     * \brief bool options tested together with a mask (See incfg::flags)
+     *
+     * Flags are packed 64 per word in registration order, so the options declared together usually
+     * share a word: testing them costs one load. Flags of a single word are read from the same version.
+     */
+    template <size_t N>
+    class FlagSet
+    {
+    public:
+        template <typename... TAGS>
+        explicit FlagSet( const OptionRef< TAGS, bool >&... refs ) : groups( 0 )
+        {
+            ( add( refs.opt ), ... );
+        }
 
         /*!
-         * \brief Loads configuration options from an std::string
-         * \param _str configuration string
+         * \brief returns true if all the flags are set
          */
-        void load( std::string& _str );
-
+        inline bool all() const
+        {
+            const std::atomic< unsigned long long >* replica = ConfigOptions::instance().local_replica();
+            for( size_t i=0; i<groups; ++i )
+                if( ( read( replica, i ) & masks[i] ) != masks[i] )
+                    return false;
+            return true;
+        }
 
         /*!
-         * \brief Loads configuration options from the command line
+         * \brief returns true if at least one of the flags is set
          */
-        void load( int argc, char* argv[] );
+        inline bool any() const
+        {
+            const std::atomic< unsigned long long >* replica = ConfigOptions::instance().local_replica();
+            for( size_t i=0; i<groups; ++i )
+                if( read( replica, i ) & masks[i] )
+                    return true;
+            return false;
+        }
 
+        inline bool none() const { return !any(); }
 
         /*!
-         * \brief returns a configuration string for the currently required list of options
+         * \brief returns the number of words holding the flags (and read by each test)
          */
-        inline std::string to_config_string() const
+        inline size_t words() const { return groups; }
+
+    private:
+        void add( const TypedOption< bool >& opt )
         {
-            std::stringstream ss;
-            //ss << "# Generated config file" << std::endl;
-            for( std::map< std::string, Option*>::const_iterator it=options.begin(); it!=options.end(); ++it )
+            for( size_t i=0; i<groups; ++i )
             {
-                if( it->second->description.length() > 0 )
+                if( flag_words[i] == opt.word )
                 {
-                    ss << "# " << it->second->description << std::endl;
-                    ss << "# " << std::endl;
+                    masks[i] |= opt.value.mask;
+                    return;
                 }
-                ss << (it->second->is_default()?"#":"") << it->first <<  "=" << it->second->get_value_as_str() << std::endl << std::endl;
             }
-            return ss.str();
+            flag_words[ groups ] = opt.word;
+            slots[ groups ] = opt.slot;
+            masks[ groups++ ] = opt.value.mask;
         }
 
+        inline unsigned long long read( const std::atomic< unsigned long long >* replica, size_t i ) const
+        {
+            return ( replica ? replica[ slots[i] ] : *flag_words[i] ).load( std::memory_order_relaxed );
+        }
 
-        /*!
-         * \brief returns the number of currenlty managed configuration options
-         */
-        inline size_t size() const
+        const std::atomic< unsigned long long >* flag_words[N];
+        size_t slots[N];
+        unsigned long long masks[N];
+        size_t groups;
+    };
+
+
+    /*!
+     * \brief Groups bool options (See INCFG_OPTION) to test them with masks
+     *
+     * ```
+     * static const auto verbose = incfg::flags( INCFG_OPTION( DEBUG_LOG ), INCFG_OPTION( TRACE ) );
+     * if( verbose.any() ) ...
+     * ```
+     */
+    template <typename... TAGS>
+    inline FlagSet< sizeof...( TAGS ) > flags( const OptionRef< TAGS, bool >&... refs )
+    {
+        return FlagSet< sizeof...( TAGS ) >( refs... );
+    }
+
+
+    namespace detail
+    {
+        // Values of an option type selecting a function variant (See Multiversion)
+        template <typename T, typename ENABLE = void>
+        struct Variants;
+
+        template <>
+        struct Variants< bool >
+        {
+            static constexpr size_t count = 2;
+            static constexpr size_t index( bool v ) { return v ? 1 : 0; }
+            static constexpr bool value( size_t idx ) { return idx != 0; }
+        };
+
+        template <typename E>
+        struct Variants< E, typename std::enable_if< std::is_enum< E >::value >::type >
+        {
+            static constexpr size_t count = EnumTable< E >::count;
+            static constexpr size_t index( E v ) { return static_cast< size_t >( v ) < count ? static_cast< size_t >( v ) : 0; }
+            static constexpr E value( size_t idx ) { return static_cast< E >( idx ); }
+        };
+    }
+
+
+    /*!
+     * \brief Function specialized at compile time for every combination of values of some options
+     *
+     * IMPL::run is a function template taking the values of the options as template arguments, so that
+     * the branches on them are resolved at compile time. All its variants are instantiated, and the one
+     * matching the current values is selected again when a publication changes options: calling it
+     * costs a single atomic load of the function pointer.
+     *
+     * ```
+     * struct Process
+     * {
+     *     template <bool DEBUG_LOG, bool CHECKSUM>
+     *     static void run( Buffer& buffer ) { ... if( DEBUG_LOG ) ... }
+     * };
+     *
+     * static auto process = incfg::multiversion< Process, void (*)( Buffer& ) >( INCFG_OPTION( DEBUG_LOG ), INCFG_OPTION( CHECKSUM ) );
+     * process( buffer );
+     * ```
+     *
+     * Options must be bool or enums declared with INCFG_ENUM. Since it refers to them,
+     * declare it after its options (in the same translation unit, or as a function local static).
+     */
+    template <typename IMPL, typename FN, typename... REFS>
+    class Multiversion;
+
+    template <typename IMPL, typename FN, typename... TAGS, typename... TS>
+    class Multiversion< IMPL, FN, OptionRef< TAGS, TS >... >
+    {
+    public:
+        static constexpr size_t count = ( size_t( 1 ) * ... * detail::Variants< TS >::count );
+
+        explicit Multiversion( const OptionRef< TAGS, TS >&... refs ) : options( refs... ), active( 0 )
+        {
+            fill( std::make_index_sequence< count >() );
+            // No publication can happen between the first update and the registration of the listener
+            ConfigOptions& co = ConfigOptions::instance();
+            ConfigOptions::WriterLock lock( co );
+            update( this );
+            co.add_listener( &Multiversion::update, this );
+        }
+
+        ~Multiversion()
         {
-            return options.size();
+            ConfigOptions::instance().remove_listener( &Multiversion::update, this );
         }
 
+        Multiversion( const Multiversion& ) = delete;
+        Multiversion& operator=( const Multiversion& ) = delete;
 
         /*!
-         * \brief option_by_index returns the idx^th configuration option
-         * \param idx index (0..size()-1) of the configuration option
+         * \brief returns the variant matching the current option values
          */
-        inline Option* option_by_index( size_t idx ) const
-        {
-            std::map< std::string, Option* >::const_iterator it = options.begin();
+        inline FN get() const { return active.load( std::memory_order_acquire ); }
 
-            while( idx>0 )
-            {
-                ++it;
-                --idx;
-            }
+        template <typename... ARGS>
+        inline decltype(auto) operator()( ARGS&&... args ) const { return get()( std::forward< ARGS >( args )... ); }
 
-            if( it!=options.end() )
-            {
-                return it->second;
-            }
+    private:
+        // Digit of an option in the index of a variant (options values in mixed radix, the first option last)
+        static constexpr size_t digit( size_t idx, size_t option )
+        {
+            const size_t counts[] = { detail::Variants< TS >::count... };
+            for( size_t i=0; i<option; ++i )
+                idx /= counts[i];
+            return idx % counts[option];
+        }
 
-            return 0;
+        template <size_t IDX, size_t... OPTS>
+        static constexpr FN variant( std::index_sequence< OPTS... > )
+        {
+            return &IMPL::template run< detail::Variants< TS >::value( digit( IDX, OPTS ) )... >;
         }
 
+        template <size_t... IDX>
+        void fill( std::index_sequence< IDX... > )
+        {
+            const FN variants[] = { variant< IDX >( std::index_sequence_for< TS... >() )... };
+            for( size_t i=0; i<count; ++i )
+                table[i] = variants[i];
+        }
 
-    private:
-        inline ConfigOptions() {}
-        ConfigOptions( const ConfigOptions& other );
-        ConfigOptions& operator=( const ConfigOptions& other );
-        std::map< std::string, Option* > options;
-        void add_if_possible( const std::string& key, const std::string& value );
+        template <size_t... OPTS>
+        size_t current( std::index_sequence< OPTS... > ) const
+        {
+            const size_t counts[] = { detail::Variants< TS >::count... };
+            const size_t digits[] = { detail::Variants< TS >::index( std::get< OPTS >( options ).read( 0 ) )... };
+            size_t idx = 0;
+            for( size_t i=sizeof...(TS); i-->0; )
+                idx = idx * counts[i] + digits[i];
+            return idx;
+        }
+
+        static void update( void* self )
+        {
+            Multiversion& mv = *static_cast< Multiversion* >( self );
+            mv.active.store( mv.table[ mv.current( std::index_sequence_for< TS... >() ) ], std::memory_order_release );
+        }
 
+        std::tuple< OptionRef< TAGS, TS >... > options;
+        FN table[ count ];
+        std::atomic< FN > active;
     };
 
 
-    inline Option::Option( const char* _name, const char* _description ) : name(_name), description(_description) {
-        ConfigOptions::instance().add_option( this );
+    template <typename IMPL, typename FN, typename... TAGS, typename... TS>
+    inline Multiversion< IMPL, FN, OptionRef< TAGS, TS >... > multiversion( const OptionRef< TAGS, TS >&... refs )
+    {
+        return Multiversion< IMPL, FN, OptionRef< TAGS, TS >... >( refs... );
     }
+
+
+    /*!
+     * \brief Multiversion of options declared without INCFG_REQUIRE (eg. incfg::Required)
+     */
+    template <typename IMPL, typename FN, typename... TS>
+    inline Multiversion< IMPL, FN, OptionRef< void, TS >... > multiversion( const TypedOption< TS >&... opts )
+    {
+        return Multiversion< IMPL, FN, OptionRef< void, TS >... >( OptionRef< void, TS >{ opts }... );
+    }
+
+
+#if __cplusplus >= 202002L
+    /*!
+     * \brief A string literal that can be used as a template argument (C++20)
+     */
+    template <size_t N>
+    struct FixedString
+    {
+        constexpr FixedString( const char (&str)[N] )
+        {
+            for( size_t i=0; i<N; ++i )
+                data[i] = str[i];
+        }
+
+        char data[N];
+    };
+
+
+    /*!
+     * \brief Macro-free option declaration (C++20)
+     *
+     * Equivalent to INCFG_REQUIRE, with the option key given as a template argument:
+     *
+     * ```
+     * inline incfg::Required< "BUFFER_SIZE", unsigned int > BUFFER_SIZE( 4096, "Buffer size used to write the log file" );
+     *
+     * char* buff = new char[ BUFFER_SIZE.get() ];
+     * ```
+     */
+    template < FixedString KEY, typename T >
+    class Required : public TypedOption< T >
+    {
+    public:
+        static constexpr const char* key = KEY.data;
+
+        Required( const T& default_value, const char* _description ) : TypedOption< T >( KEY.data, default_value, _description ) {}
+    };
+#endif
 }
 
 
@@ -502,42 +3030,38 @@ namespace incfg
 
 
 
+/*!
+ * Debug builds can define INCFG_CHECK_TYPES to check, during static initialization, that each
+ * translation unit requires an option with the type it was registered with (See ConfigOptions::check_type).
+ * The check is off by default, as it adds a dynamic initializer per option in every translation unit.
+ */
+#ifdef INCFG_CHECK_TYPES
+#define INCFG_TYPE_CHECK( TYPE, CONFIGNAME )\
+[[maybe_unused]] static const bool incfg_  ## CONFIGNAME ## _Type_checked =\
+    incfg::ConfigOptions::instance().check_type( # CONFIGNAME, &incfg::detail::TypeId< TYPE >::id );
+#else
+#define INCFG_TYPE_CHECK( TYPE, CONFIGNAME )
+#endif
+
+
 /*!
  *  \brief Globally declares that a configuration key-value pair is required
  *  \hideinitializer
  *
+ * The same option can be required in more than one translation unit, always with the same
+ * type, default value and description. With INCFG_CHECK_TYPES defined, requiring it with a
+ * different type throws a std::logic_error during static initialization.
+ *
  * \param TYPE Value type
  * \param CONFIGNAME Configuration option name (key)
  * \param DEFAULTVAL Default option value
  * \param DESCRIPTION Option description (c-string)
  */
 #define INCFG_REQUIRE( TYPE, CONFIGNAME, DEFAULTVAL, DESCRIPTION )\
-class incfg_  ## CONFIGNAME ## _Option : public incfg::Option \
-{ \
-public: \
-incfg_  ## CONFIGNAME ## _Option() : incfg::Option(  # CONFIGNAME  , # DESCRIPTION ), is_def(false) {} \
-incfg_  ## CONFIGNAME ## _Option( TYPE  v ) : incfg::Option(  # CONFIGNAME ,  DESCRIPTION  ), is_def(true), value(v) {}; \
-inline void parse_value_from_str( std::string str ) \
-{ \
-    set( incfg::from_string_helper< TYPE >( str, value ) );\
-}\
-inline std::string get_value_as_str() const\
-{\
-    return incfg::to_string_helper< TYPE >( value );\
-}\
-inline bool is_default() const { return is_def; } \
-inline bool is_bool() const { return incfg::is_boolean< TYPE >( value ); } \
-inline TYPE get() const { return value; }\
-inline void set( const TYPE& new_value )\
-{\
-    is_def = is_def && (new_value == value);\
-    value = new_value;\
-}\
-private:\
-TYPE value;\
-bool is_def;\
-};\
-static incfg_  ## CONFIGNAME ## _Option incfg_  ## CONFIGNAME ## _Option_instance( DEFAULTVAL );
+struct incfg_  ## CONFIGNAME ## _Tag;\
+inline incfg::TypedOption< TYPE > incfg_  ## CONFIGNAME ## _Option_instance( # CONFIGNAME, DEFAULTVAL, DESCRIPTION,\
+    incfg::frozen_value< incfg_  ## CONFIGNAME ## _Tag, TYPE >() );\
+INCFG_TYPE_CHECK( TYPE, CONFIGNAME )
 
 
 /*!
@@ -546,7 +3070,16 @@ static incfg_  ## CONFIGNAME ## _Option incfg_  ## CONFIGNAME ## _Option_instanc
  *
  */
 #define INCFG_GET( CONFIGNAME )\
-(incfg_  ## CONFIGNAME ## _Option(), dynamic_cast< incfg_  ## CONFIGNAME ## _Option* >( incfg::ConfigOptions::instance().get( # CONFIGNAME ))->get() )
+(incfg::get_option< incfg_  ## CONFIGNAME ## _Tag >( incfg_  ## CONFIGNAME ## _Option_instance ))
+
+
+/*!
+ * Returns the number of changes of the value associated to a CONFIGNAME key (See incfg::Option::version)
+ * \hideinitializer
+ *
+ */
+#define INCFG_VERSION( CONFIGNAME )\
+(incfg_  ## CONFIGNAME ## _Option_instance.version())
 
 
 /*!
@@ -555,8 +3088,75 @@ static incfg_  ## CONFIGNAME ## _Option incfg_  ## CONFIGNAME ## _Option_instanc
  *
  */
 #define INCFG_SET( CONFIGNAME, VALUE )\
-(incfg_  ## CONFIGNAME ## _Option(), dynamic_cast< incfg_  ## CONFIGNAME ## _Option* >( incfg::ConfigOptions::instance().get( # CONFIGNAME ))->set(VALUE) )
+(incfg::set_option< incfg_  ## CONFIGNAME ## _Tag >( incfg_  ## CONFIGNAME ## _Option_instance, VALUE ))
+
+
+/*!
+ * \brief Declares the names of the enumerators of TYPE, an enum whose values are 0, 1, 2... in
+ * the same order, so that it can be used as an option type. Must be used in the global namespace.
+ * \hideinitializer
+ *
+ * ```
+ * enum class Mode { Fast, Safe, Debug };
+ * INCFG_ENUM( Mode, "fast", "safe", "debug" )
+ * INCFG_REQUIRE( Mode, MODE, Mode::Safe, "Processing mode" )
+ * ```
+ */
+#define INCFG_ENUM( TYPE, ... )\
+namespace incfg\
+{\
+    template < > struct EnumNames< TYPE > { static constexpr const char* names[] = { __VA_ARGS__ }; };\
+    template < > inline std::string to_string_helper< TYPE >( TYPE val ) { return enum_to_string( val ); }\
+    template < > inline TYPE from_string_helper< TYPE >( std::string str, const TYPE& ) { return enum_from_string< TYPE >( str ); }\
+    template < > inline Expected< TYPE > parse_value< TYPE >( const std::string& str, const TYPE& ) { return enum_parse< TYPE >( str ); }\
+}
+
+
+/*!
+ * \brief Stages a new VALUE for CONFIGNAME key in an incfg::Batch
+ * \hideinitializer
+ *
+ */
+#define INCFG_BATCH_SET( BATCH, CONFIGNAME, VALUE )\
+((BATCH).set< incfg_  ## CONFIGNAME ## _Tag >( incfg_  ## CONFIGNAME ## _Option_instance, VALUE ))
+
+
+/*!
+ * \brief Refers to the option of a CONFIGNAME key, to read it with incfg::get_consistent
+ * \hideinitializer
+ *
+ */
+#define INCFG_OPTION( CONFIGNAME )\
+(incfg::option_ref< incfg_  ## CONFIGNAME ## _Tag >( incfg_  ## CONFIGNAME ## _Option_instance ))
+
+
+/*!
+ * \brief Binds the FIELD of STRUCT to the option of a CONFIGNAME key, so that incfg::refresh copies it.
+ * Must be used in the global namespace, once per field.
+ * \hideinitializer
+ *
+ */
+#define INCFG_BIND( STRUCT, FIELD, CONFIGNAME )\
+template < > inline const bool incfg::detail::FieldBinding< &STRUCT::FIELD >::bound =\
+    incfg::Binding< STRUCT >::instance().bind( &incfg::Binding< STRUCT >::copy_field< incfg_  ## CONFIGNAME ## _Tag, &STRUCT::FIELD, incfg_  ## CONFIGNAME ## _Option_instance >,\
+                                               incfg_  ## CONFIGNAME ## _Option_instance );
+
+
+
+/*!
+ * If defined, the header (generated by ConfigOptions::to_frozen_header) freezing the option values
+ * of a specialized build
+ */
+#ifdef INCFG_FROZEN_CONFIG
+#include INCFG_FROZEN_CONFIG
+#endif
+
+
 
+#ifdef INCFG_HEADER_ONLY
+#include "incfg.cpp"
+#endif
 
+#endif //INCFG_EMBEDDED
 
 #endif //INCFG_INCFG_HPP_H
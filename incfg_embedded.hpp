@@ -0,0 +1,645 @@
+/*!
+    incfg embedded profile (See incfg.hpp for description/usage)
+--------------------------------------------------------------------------------
+
+The MIT License
+Copyright (c) 2015 Filippo Bergamasco
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef INCFG_INCFG_EMBEDDED_HPP
+#define INCFG_INCFG_EMBEDDED_HPP
+
+#include <charconv>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+
+/*! \file incfg_embedded.hpp
+ * \brief Embedded profile: a fixed-capacity registry that never allocates
+ *
+ * Selected by defining INCFG_EMBEDDED before including incfg.hpp (incfg.cpp is then not needed).
+ * ```INCFG_REQUIRE```, ```INCFG_GET``` and ```INCFG_SET``` keep their meaning, but:
+ *
+ * - options are registered in a static array of INCFG_MAX_OPTIONS entries
+ * - option types are bool, arithmetic types, enums declared with INCFG_ENUM and incfg::InlineString
+ * - configurations are parsed from caller buffers, and errors are returned as incfg::Status
+ * - registration errors (registry full, duplicated key) call the fail handler (See set_fail_handler)
+ * - options are meant to be set at boot: sets must not race with reads
+ *
+ * Nothing is allocated and nothing is thrown, so it builds with ```-fno-exceptions -fno-rtti```.
+ */
+
+/*!
+ * Maximum number of options of the embedded registry
+ */
+#ifndef INCFG_MAX_OPTIONS
+#define INCFG_MAX_OPTIONS 128
+#endif
+
+/*!
+ * Maximum length of a value once unquoted, in bytes (the tokenizer decodes it in a buffer on the stack)
+ */
+#ifndef INCFG_MAX_VALUE_LENGTH
+#define INCFG_MAX_VALUE_LENGTH 256
+#endif
+
+namespace incfg
+{
+    /*!
+     * \brief Error codes of the embedded loaders
+     */
+    enum class Errc
+    {
+        ok,
+        unknown_key,        //!< the key is not registered
+        invalid_value,      //!< the value cannot be parsed to the option type
+        syntax_error,       //!< the line is not a ```<key> = <value>``` assignment
+        line_too_long,      //!< the line does not fit in the Parser buffer
+        value_too_long,     //!< the unquoted value is longer than INCFG_MAX_VALUE_LENGTH
+        missing_value       //!< a command-line key is not followed by its value
+    };
+
+
+    /*!
+     * \brief Result of a load: an error code and the line (or argv index) where it occurred
+     */
+    struct Status
+    {
+        constexpr Status() : code( Errc::ok ), line( 0 ) {}
+        constexpr Status( Errc _code, size_t _line ) : code( _code ), line( _line ) {}
+
+        constexpr bool ok() const { return code == Errc::ok; }
+        constexpr explicit operator bool() const { return ok(); }
+
+        const char* message() const
+        {
+            switch( code )
+            {
+            case Errc::ok: return "Success";
+            case Errc::unknown_key: return "Unexpected key";
+            case Errc::invalid_value: return "Invalid value";
+            case Errc::syntax_error: return "<key> = <value> expected";
+            case Errc::line_too_long: return "Line too long";
+            case Errc::value_too_long: return "Value too long";
+            case Errc::missing_value: return "A value is expected";
+            }
+            return "Unknown error";
+        }
+
+        Errc code;
+        size_t line;
+    };
+
+
+    /*!
+     * \brief Function called on unrecoverable errors (the program is aborted if it returns)
+     */
+    typedef void (*FailHandler)( const char* message );
+
+    inline FailHandler fail_handler = 0;
+
+    inline void set_fail_handler( FailHandler handler ) { fail_handler = handler; }
+
+    [[noreturn]] inline void fail( const char* message )
+    {
+        if( fail_handler )
+            fail_handler( message );
+        std::abort();
+    }
+
+
+    /*!
+     * \brief A string of at most N-1 characters stored inline, the string type of the embedded profile
+     */
+    template <size_t N>
+    class InlineString
+    {
+    public:
+        constexpr InlineString() : buffer(), len( 0 ) {}
+
+        constexpr InlineString( const char* str ) : buffer(), len( 0 )
+        {
+            while( str[len] && len+1 < N )
+            {
+                buffer[len] = str[len];
+                ++len;
+            }
+        }
+
+        /*!
+         * \brief Copies a string, returns false (leaving the value unchanged) if it does not fit
+         */
+        bool assign( const char* str, size_t length )
+        {
+            if( length+1 > N )
+                return false;
+            std::memcpy( buffer, str, length );
+            buffer[length] = 0;
+            len = length;
+            return true;
+        }
+
+        inline const char* c_str() const { return buffer; }
+        inline size_t length() const { return len; }
+        static constexpr size_t capacity() { return N-1; }
+
+        bool operator==( const InlineString& other ) const { return len == other.len && std::memcmp( buffer, other.buffer, len ) == 0; }
+        bool operator!=( const InlineString& other ) const { return !( *this == other ); }
+
+    private:
+        char buffer[N];
+        size_t len;
+    };
+
+
+    /*!
+     * \brief Names of the enumerators of an enum option type, in the order of their values (See INCFG_ENUM)
+     */
+    template <typename E>
+    struct EnumNames;
+
+
+    /*!
+     * Non-throwing conversions of the embedded profile, the customization points for other types:
+     * parse_value returns false if the string is invalid, format_value returns the length of the
+     * formatted value (written only if it fits in ```cap``` bytes).
+     */
+    template <typename T>
+    inline typename std::enable_if< std::is_arithmetic< T >::value, bool >::type
+    parse_value( const char* str, size_t len, T& out )
+    {
+        const std::from_chars_result res = std::from_chars( str, str+len, out );
+        return res.ec == std::errc() && res.ptr == str+len;
+    }
+
+    inline bool parse_value( const char* str, size_t len, bool& out )
+    {
+        if( len == 4 && std::memcmp( str, "true", 4 ) == 0 )
+            out = true;
+        else if( len == 5 && std::memcmp( str, "false", 5 ) == 0 )
+            out = false;
+        else
+            return false;
+        return true;
+    }
+
+    template <size_t N>
+    inline bool parse_value( const char* str, size_t len, InlineString< N >& out )
+    {
+        return out.assign( str, len );
+    }
+
+    template <typename E>
+    inline typename std::enable_if< std::is_enum< E >::value, bool >::type
+    parse_value( const char* str, size_t len, E& out )
+    {
+        const size_t count = sizeof( EnumNames< E >::names ) / sizeof( EnumNames< E >::names[0] );
+        for( size_t i=0; i<count; ++i )
+        {
+            if( std::strlen( EnumNames< E >::names[i] ) == len && std::memcmp( EnumNames< E >::names[i], str, len ) == 0 )
+            {
+                out = static_cast< E >( i );
+                return true;
+            }
+        }
+        return false;
+    }
+
+
+    namespace detail
+    {
+        inline size_t copy_out( const char* str, size_t len, char* buf, size_t cap )
+        {
+            if( len <= cap )
+                std::memcpy( buf, str, len );
+            return len;
+        }
+    }
+
+    template <typename T>
+    inline typename std::enable_if< std::is_arithmetic< T >::value, size_t >::type
+    format_value( const T& val, char* buf, size_t cap )
+    {
+        char tmp[64];
+        const std::to_chars_result res = std::to_chars( tmp, tmp+sizeof(tmp), val );
+        return detail::copy_out( tmp, res.ptr-tmp, buf, cap );
+    }
+
+    inline size_t format_value( const bool& val, char* buf, size_t cap )
+    {
+        return val ? detail::copy_out( "true", 4, buf, cap ) : detail::copy_out( "false", 5, buf, cap );
+    }
+
+    template <size_t N>
+    inline size_t format_value( const InlineString< N >& val, char* buf, size_t cap )
+    {
+        // Quoted, escaping the characters decoded by the tokenizer
+        size_t len = 0;
+        const auto put = [&]( char c ) { if( len < cap ) buf[len] = c; ++len; };
+        put( '"' );
+        for( size_t i=0; i<val.length(); ++i )
+        {
+            const char c = val.c_str()[i];
+            switch( c )
+            {
+            case '"': put( '\\' ); put( '"' ); break;
+            case '\\': put( '\\' ); put( '\\' ); break;
+            case '\n': put( '\\' ); put( 'n' ); break;
+            case '\r': put( '\\' ); put( 'r' ); break;
+            case '\t': put( '\\' ); put( 't' ); break;
+            default: put( c ); break;
+            }
+        }
+        put( '"' );
+        return len;
+    }
+
+    template <typename E>
+    inline typename std::enable_if< std::is_enum< E >::value, size_t >::type
+    format_value( const E& val, char* buf, size_t cap )
+    {
+        const size_t count = sizeof( EnumNames< E >::names ) / sizeof( EnumNames< E >::names[0] );
+        if( static_cast< size_t >( val ) >= count )
+            return format_value( static_cast< long long >( val ), buf, cap );
+        const char* name = EnumNames< E >::names[ static_cast< size_t >( val ) ];
+        return detail::copy_out( name, std::strlen( name ), buf, cap );
+    }
+
+
+    /*!
+     * \brief Option interface of the embedded profile
+     */
+    class Option
+    {
+    public:
+        constexpr Option( const char* _name, const char* _description ) : name( _name ), description( _description ) {}
+
+        virtual bool parse_value( const char* str, size_t len ) = 0;
+        virtual size_t format_value( char* buf, size_t cap ) const = 0;
+        virtual bool is_default() const = 0;
+        virtual bool is_bool() const = 0;
+
+        const char* const name;
+        const char* const description;
+
+    protected:
+        ~Option() {}
+    };
+
+
+    class ConfigOptions
+    {
+    public:
+        static inline ConfigOptions& instance() { return singleton; }
+
+        /*!
+         * \brief Registers a new option (the fail handler is called if the registry is full or the key is taken)
+         */
+        void add_option( Option* opt )
+        {
+            if( get( opt->name ) )
+                fail( "incfg: option required more than once" );
+            if( count == INCFG_MAX_OPTIONS )
+                fail( "incfg: too many options (See INCFG_MAX_OPTIONS)" );
+            options[ count++ ] = opt;
+        }
+
+        /*!
+         * \brief Returns the option of a key (or NULL if no such option exists)
+         */
+        Option* get( const char* key, size_t len ) const
+        {
+            for( size_t i=0; i<count; ++i )
+                if( std::strncmp( options[i]->name, key, len ) == 0 && options[i]->name[len] == 0 )
+                    return options[i];
+            return 0;
+        }
+
+        inline Option* get( const char* key ) const { return get( key, std::strlen( key ) ); }
+        inline size_t size() const { return count; }
+        inline Option* option_by_index( size_t idx ) const { return idx < count ? options[idx] : 0; }
+
+        /*!
+         * \brief Loads a configuration string (not modified), stopping at the first invalid line
+         */
+        Status load( const char* config, size_t len );
+
+        /*!
+         * \brief Loads options from command-line arguments (```--key value```, or ```--key``` for bool options)
+         */
+        Status load( int argc, char* argv[] )
+        {
+            for( int idx=1; idx<argc; ++idx )
+            {
+                const char* arg = argv[idx];
+                if( arg[0] != '-' || arg[1] != '-' || arg[2] == 0 )
+                    return Status( Errc::syntax_error, idx );
+
+                Option* opt = get( arg+2 );
+                if( !opt )
+                    return Status( Errc::unknown_key, idx );
+
+                if( opt->is_bool() )
+                {
+                    opt->parse_value( "true", 4 );
+                    continue;
+                }
+
+                if( ++idx == argc )
+                    return Status( Errc::missing_value, idx-1 );
+                if( !opt->parse_value( argv[idx], std::strlen( argv[idx] ) ) )
+                    return Status( Errc::invalid_value, idx );
+            }
+            return Status();
+        }
+
+        /*!
+         * \brief Writes the configuration (```<key> = <value>``` lines) and returns its length
+         *
+         * Like snprintf, the output is truncated if longer than ```cap``` bytes, and the length returned
+         * is the one needed. No terminating null is written.
+         */
+        size_t to_config_string( char* buf, size_t cap ) const
+        {
+            size_t len = 0;
+            for( size_t i=0; i<count; ++i )
+            {
+                len += detail::copy_out( options[i]->name, std::strlen( options[i]->name ), buf+len, len < cap ? cap-len : 0 );
+                len += detail::copy_out( " = ", 3, buf+len, len < cap ? cap-len : 0 );
+                len += options[i]->format_value( buf+len, len < cap ? cap-len : 0 );
+                len += detail::copy_out( "\n", 1, buf+len, len < cap ? cap-len : 0 );
+            }
+            return len;
+        }
+
+    private:
+        constexpr ConfigOptions() : options(), count( 0 ) {}
+        ConfigOptions( const ConfigOptions& other );
+        ConfigOptions& operator=( const ConfigOptions& other );
+        static ConfigOptions singleton;
+
+        Option* options[ INCFG_MAX_OPTIONS ];
+        size_t count;
+    };
+
+    inline ConfigOptions ConfigOptions::singleton;
+
+
+    namespace detail
+    {
+        /*
+         * Parses a line (without its '\n') and sets its option: the grammar is the one of the full
+         * profile. Quoted values are decoded in a buffer on the stack.
+         */
+        inline Errc parse_line( ConfigOptions& co, const char* p, const char* end )
+        {
+            while( p != end && ( *p==' ' || *p=='\t' || *p=='\r' ) )
+                ++p;
+            if( p == end || *p == '#' )
+                return Errc::ok;
+
+            const char* key = p;
+            while( p != end && *p != '=' && *p != ' ' && *p != '\t' && *p != '\r' )
+                ++p;
+            const char* key_end = p;
+            while( p != end && ( *p==' ' || *p=='\t' || *p=='\r' ) )
+                ++p;
+            if( p == end || *p != '=' || key == key_end )
+                return Errc::syntax_error;
+
+            ++p;
+            while( p != end && ( *p==' ' || *p=='\t' || *p=='\r' ) )
+                ++p;
+            while( end != p && ( end[-1]==' ' || end[-1]=='\t' || end[-1]=='\r' ) )
+                --end;
+
+            char value[ INCFG_MAX_VALUE_LENGTH ];
+            size_t len = 0;
+            if( p != end && *p == '"' )
+            {
+                if( end-p < 2 || end[-1] != '"' )
+                    return Errc::syntax_error;
+                for( ++p, --end; p != end; ++p )
+                {
+                    char c = *p;
+                    if( c == '"' )
+                        return Errc::syntax_error;
+                    if( c == '\\' && p+1 != end )
+                    {
+                        switch( *++p )
+                        {
+                        case 'n': c = '\n'; break;
+                        case 'r': c = '\r'; break;
+                        case 't': c = '\t'; break;
+                        case '"': c = '"'; break;
+                        case '\\': c = '\\'; break;
+                        default:
+                            if( len == sizeof(value) )
+                                return Errc::value_too_long;
+                            value[len++] = '\\';
+                            c = *p;
+                            break;
+                        }
+                    }
+                    if( len == sizeof(value) )
+                        return Errc::value_too_long;
+                    value[len++] = c;
+                }
+            }
+            else
+            {
+                if( static_cast< size_t >( end-p ) > sizeof(value) )
+                    return Errc::value_too_long;
+                len = end-p;
+                std::memcpy( value, p, len );
+            }
+
+            Option* opt = co.get( key, key_end-key );
+            if( !opt )
+                return Errc::unknown_key;
+            return opt->parse_value( value, len ) ? Errc::ok : Errc::invalid_value;
+        }
+    }
+
+
+    inline Status ConfigOptions::load( const char* config, size_t len )
+    {
+        const char* const end = config + len;
+        for( size_t line=1; config != end; ++line )
+        {
+            const char* newline = static_cast< const char* >( std::memchr( config, '\n', end-config ) );
+            const char* line_end = newline ? newline : end;
+            const Errc err = detail::parse_line( *this, config, line_end );
+            if( err != Errc::ok )
+                return Status( err, line );
+            config = newline ? newline+1 : end;
+        }
+        return Status();
+    }
+
+
+    /*!
+     * \brief Incremental parser of the embedded profile: partial lines are kept in a caller buffer
+     *
+     * ```
+     * char line[128];
+     * incfg::Parser parser( incfg::ConfigOptions::instance(), line, sizeof(line) );
+     * while( (len = uart_read( block, sizeof(block) )) > 0 )
+     *     if( !(status = parser.feed( block, len )) ) ...
+     * status = parser.finish();
+     * ```
+     */
+    class Parser
+    {
+    public:
+        Parser( ConfigOptions& _co, char* _buffer, size_t _capacity ) : co( _co ), buffer( _buffer ), capacity( _capacity ), partial( 0 ), linenum( 0 ) {}
+
+        /*!
+         * \brief Parses the complete lines of a block (in place), and keeps the last partial one
+         */
+        Status feed( const char* data, size_t len )
+        {
+            const char* const end = data + len;
+            while( data != end )
+            {
+                const char* newline = static_cast< const char* >( std::memchr( data, '\n', end-data ) );
+                const char* line_end = newline ? newline : end;
+                if( partial + (line_end-data) > capacity )
+                    return Status( Errc::line_too_long, linenum+1 );
+
+                if( !newline )
+                {
+                    std::memcpy( buffer+partial, data, line_end-data );
+                    partial += line_end-data;
+                    break;
+                }
+
+                ++linenum;
+                Errc err;
+                if( partial )
+                {
+                    std::memcpy( buffer+partial, data, line_end-data );
+                    err = detail::parse_line( co, buffer, buffer+partial+(line_end-data) );
+                    partial = 0;
+                }
+                else
+                {
+                    err = detail::parse_line( co, data, line_end );
+                }
+                if( err != Errc::ok )
+                    return Status( err, linenum );
+                data = newline+1;
+            }
+            return Status();
+        }
+
+        /*!
+         * \brief Parses the last line if not terminated by a newline
+         */
+        Status finish()
+        {
+            if( !partial )
+                return Status();
+            ++linenum;
+            const Errc err = detail::parse_line( co, buffer, buffer+partial );
+            partial = 0;
+            return err == Errc::ok ? Status() : Status( err, linenum );
+        }
+
+        inline size_t lines() const { return linenum; }
+
+    private:
+        ConfigOptions& co;
+        char* buffer;
+        size_t capacity;
+        size_t partial;
+        size_t linenum;
+    };
+
+
+    template <typename T>
+    class TypedOption : public Option
+    {
+    public:
+        typedef T value_type;
+
+        TypedOption( const char* _name, const T& default_value, const char* _description )
+            : Option( _name, _description ), value( default_value ), is_def( true )
+        {
+            ConfigOptions::instance().add_option( this );
+        }
+
+        bool parse_value( const char* str, size_t len )
+        {
+            T new_value = value;
+            if( !incfg::parse_value( str, len, new_value ) )
+                return false;
+            set( new_value );
+            return true;
+        }
+
+        size_t format_value( char* buf, size_t cap ) const { return incfg::format_value( value, buf, cap ); }
+        bool is_default() const { return is_def; }
+        bool is_bool() const { return std::is_same< T, bool >::value; }
+
+        inline const T& get() const { return value; }
+
+        inline void set( const T& new_value )
+        {
+            is_def = is_def && new_value == value;
+            value = new_value;
+        }
+
+    private:
+        T value;
+        bool is_def;
+    };
+}
+
+
+/*!
+ * \brief Defines an option (See incfg.hpp), registered in the fixed-capacity registry
+ * \hideinitializer
+ */
+#define INCFG_REQUIRE( TYPE, CONFIGNAME, DEFAULTVAL, DESCRIPTION )\
+struct incfg_  ## CONFIGNAME ## _Tag;\
+inline incfg::TypedOption< TYPE > incfg_  ## CONFIGNAME ## _Option_instance( # CONFIGNAME, DEFAULTVAL, DESCRIPTION );
+
+#define INCFG_GET( CONFIGNAME )\
+(incfg_  ## CONFIGNAME ## _Option_instance.get())
+
+#define INCFG_SET( CONFIGNAME, VALUE )\
+(incfg_  ## CONFIGNAME ## _Option_instance.set( VALUE ))
+
+/*!
+ * \brief Declares the names of the enumerators of TYPE (See incfg.hpp), parsed by a linear search
+ * \hideinitializer
+ */
+#define INCFG_ENUM( TYPE, ... )\
+namespace incfg\
+{\
+    template < > struct EnumNames< TYPE > { static constexpr const char* names[] = { __VA_ARGS__ }; };\
+}
+
+#endif //INCFG_INCFG_EMBEDDED_HPP
@@ -0,0 +1,373 @@
+/*!
+    incfg online auto-tuner of numeric options (See incfg.hpp for description/usage)
+--------------------------------------------------------------------------------
+
+The MIT License
+Copyright (c) 2015 Filippo Bergamasco
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef INCFG_INCFG_TUNER_HPP
+#define INCFG_INCFG_TUNER_HPP
+
+#include "incfg.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+/*! \file incfg_tuner.hpp
+ * \brief Online auto-tuner of numeric options
+ *
+ * A Tuner adjusts a numeric option within bounds to maximize an objective measured by the
+ * application (eg. the throughput of the last interval), by hill climbing: the value is moved by
+ * one step, kept if the objective improved and reverted otherwise, the direction alternating and
+ * the step shrinking after failures in both directions. The baseline is measured again after each
+ * revert, so the tuner keeps following a workload that drifts. If the option is set by someone else
+ * (eg. a reload), the measurement is discarded and the search restarts from the new value.
+ *
+ * Values are published with the option setter, as INCFG_SET does, and each decision is recorded
+ * in a bounded history.
+ */
+
+namespace incfg
+{
+    /*!
+     * \brief Search space of a Tuner
+     *
+     * Linear steps add or subtract ```step```, geometric steps multiply or divide by ```step``` (> 1).
+     * After failures in both directions the step is halved (its excess over 1 if geometric), down to
+     * ```min_step```. A new value is kept if its objective exceeds the baseline by ```min_gain```
+     * (relative), which filters out measurement noise.
+     */
+    template <typename T>
+    struct TunerPolicy
+    {
+        T min;
+        T max;
+        double step;
+        double min_step;
+        bool geometric;
+        double min_gain;
+    };
+
+
+    /*!
+     * \brief Linear search of [min, max] by steps of step, then down to min_step
+     */
+    template <typename T>
+    inline TunerPolicy< T > linear_policy( T min, T max, double step, double min_step = 1, double min_gain = 0 )
+    {
+        return TunerPolicy< T >{ min, max, step, min_step, false, min_gain };
+    }
+
+
+    /*!
+     * \brief Geometric search of [min, max] by factors of ratio (eg. 2 to double or halve buffer sizes)
+     */
+    template <typename T>
+    inline TunerPolicy< T > geometric_policy( T min, T max, double ratio, double min_ratio = 1.1, double min_gain = 0 )
+    {
+        return TunerPolicy< T >{ min, max, ratio, min_ratio, true, min_gain };
+    }
+
+
+    /*!
+     * \brief What a Tuner did with a measurement (See Tuner::history)
+     */
+    enum class TunerAction
+    {
+        baseline,       //!< the current value was measured, a neighbour is tried next
+        accepted,       //!< the tried value improved the objective and is kept
+        rejected,       //!< the tried value did not improve the objective and was reverted
+        restarted,      //!< the option was set by someone else: the search restarts from its value
+        failed          //!< the option could not be set (eg. sealed): the tuner stopped
+    };
+
+
+    /*!
+     * \brief Online hill-climbing tuner of a numeric option (See incfg_tuner.hpp)
+     *
+     * ```
+     * incfg::Tuner< unsigned int > tuner( INCFG_OPTION( BUFFER_SIZE ), incfg::geometric_policy( 512u, 1u << 20, 2.0 ),
+     *                                     [&]() { return stats.throughput_since_last_call(); } );
+     * tuner.start( std::chrono::seconds( 10 ) );
+     * ```
+     *
+     * ```step()``` can also be called directly (eg. at the end of each batch of work) instead of
+     * running the background thread.
+     */
+    template <typename T>
+    class Tuner
+    {
+    public:
+        static_assert( std::is_arithmetic< T >::value && !std::is_same< T, bool >::value, "Tuner requires a numeric option type" );
+
+        struct Decision
+        {
+            std::chrono::steady_clock::time_point time;
+            T value;                //!< the value measured
+            double score;           //!< the objective measured for it
+            TunerAction action;
+            T next;                 //!< the value set for the next interval
+        };
+
+        /*!
+         * \param objective Returns the score of the value in effect since its previous call (higher is better)
+         * \param history_capacity Number of decisions kept (the oldest are dropped)
+         */
+        Tuner( TypedOption< T >& _opt, const TunerPolicy< T >& _policy, std::function< double() > _objective, size_t history_capacity = 256 )
+            : opt( _opt ), policy( _policy ), objective( _objective ), step_size( _policy.step ), direction( 1 ),
+              failures( 0 ), probing( false ), stopped( false ), base( _opt.get() ), base_score( 0 ), current( base ),
+              current_version( _opt.version() ), capacity( history_capacity ), first( 0 ), running( false )
+        {
+            if( opt.is_frozen() )
+                INCFG_THROW( std::logic_error("Option " + opt.name + " is frozen and cannot be tuned") );
+        }
+
+        template <typename TAG>
+        Tuner( const OptionRef< TAG, T >& ref, const TunerPolicy< T >& _policy, std::function< double() > _objective, size_t history_capacity = 256 )
+            : Tuner( const_cast< TypedOption< T >& >( ref.opt ), _policy, _objective, history_capacity )
+        {
+            static_assert( !Frozen< TAG >::value, "Frozen options cannot be tuned" );
+        }
+
+        ~Tuner() { stop(); }
+
+        /*!
+         * \brief Measures the value set for the last interval and sets the value of the next one
+         * \return false if the tuner stopped because the option could not be set
+         */
+        bool step()
+        {
+            std::lock_guard< std::mutex > lock( mutex );
+            if( stopped )
+                return false;
+
+            const T value = opt.get();
+            const double score = objective();
+            if( value != current || opt.version() != current_version )
+            {
+                // The score measured another value: the search restarts from it, with the initial step
+                probing = false;
+                step_size = policy.step;
+                direction = 1;
+                failures = 0;
+                base = value;
+                return publish( value, score, TunerAction::restarted, value );
+            }
+
+            TunerAction action = TunerAction::baseline;
+            if( probing )
+            {
+                if( score > base_score + std::fabs( base_score ) * policy.min_gain )
+                {
+                    action = TunerAction::accepted;
+                    base = value;
+                    base_score = score;
+                    failures = 0;
+                }
+                else
+                {
+                    // Reverted: the baseline is measured again in the next interval
+                    action = TunerAction::rejected;
+                    direction = -direction;
+                    if( ++failures >= 2 )
+                    {
+                        shrink_step();
+                        failures = 0;
+                    }
+                    probing = false;
+                    return publish( value, score, action, base );
+                }
+            }
+            else
+            {
+                base = value;
+                base_score = score;
+            }
+
+            T next = neighbour( base, direction );
+            if( next == base )
+            {
+                direction = -direction;
+                next = neighbour( base, direction );
+            }
+            probing = next != base;
+            return publish( value, score, action, next );
+        }
+
+        /*!
+         * \brief Runs step() every interval in a background thread, until stop()
+         */
+        void start( std::chrono::milliseconds interval )
+        {
+            stop();
+            running = true;
+            thread = std::thread( [this, interval]()
+            {
+                std::unique_lock< std::mutex > lock( thread_mutex );
+                while( !wake.wait_for( lock, interval, [this]() { return !running; } ) )
+                {
+                    lock.unlock();
+                    const bool ok = step();
+                    lock.lock();
+                    if( !ok )
+                        break;
+                }
+            } );
+        }
+
+        /*!
+         * \brief Stops the background thread (if any). The option keeps its current value.
+         */
+        void stop()
+        {
+            {
+                std::lock_guard< std::mutex > lock( thread_mutex );
+                running = false;
+            }
+            wake.notify_all();
+            if( thread.joinable() )
+                thread.join();
+        }
+
+        /*!
+         * \brief returns the best value found so far (the value the search is centered on)
+         */
+        T best() const
+        {
+            std::lock_guard< std::mutex > lock( mutex );
+            return base;
+        }
+
+        /*!
+         * \brief returns the recorded decisions, oldest first
+         */
+        std::vector< Decision > history() const
+        {
+            std::lock_guard< std::mutex > lock( mutex );
+            std::vector< Decision > out( decisions.begin() + first, decisions.end() );
+            out.insert( out.end(), decisions.begin(), decisions.begin() + first );
+            return out;
+        }
+
+        /*!
+         * \brief returns true if the tuner stopped because the option could not be set
+         */
+        bool is_stopped() const
+        {
+            std::lock_guard< std::mutex > lock( mutex );
+            return stopped;
+        }
+
+    private:
+        Tuner( const Tuner& other );
+        Tuner& operator=( const Tuner& other );
+
+        // The value one step away from val in a direction, rounded and clamped to the bounds
+        T neighbour( T val, int dir ) const
+        {
+            double next = static_cast< double >( val );
+            if( policy.geometric )
+                next = dir > 0 ? next * step_size : next / step_size;
+            else
+                next += dir * step_size;
+
+            // A step rounded away, or a geometric step from 0, moves by one unit instead
+            if( std::is_integral< T >::value )
+                next = std::round( next );
+            if( next == static_cast< double >( val ) && ( std::is_integral< T >::value || val == 0 ) )
+                next += dir;
+            if( next < static_cast< double >( policy.min ) )
+                return policy.min;
+            if( next > static_cast< double >( policy.max ) )
+                return policy.max;
+            return static_cast< T >( next );
+        }
+
+        void shrink_step()
+        {
+            if( policy.geometric )
+                step_size = std::max( 1 + ( step_size-1 ) / 2, policy.min_step );
+            else
+                step_size = std::max( step_size / 2, policy.min_step );
+        }
+
+        bool publish( T value, double score, TunerAction action, T next )
+        {
+            if( next != value && !opt.try_set( next ) )
+            {
+                action = TunerAction::failed;
+                next = value;
+                stopped = true;
+            }
+
+            current = next;
+            current_version = opt.version();
+
+            const Decision decision = { std::chrono::steady_clock::now(), value, score, action, next };
+            if( decisions.size() < capacity )
+            {
+                decisions.push_back( decision );
+            }
+            else if( capacity > 0 )
+            {
+                decisions[ first ] = decision;
+                first = ( first+1 ) % capacity;
+            }
+            return !stopped;
+        }
+
+        TypedOption< T >& opt;
+        const TunerPolicy< T > policy;
+        std::function< double() > objective;
+
+        // Search state, guarded by mutex
+        mutable std::mutex mutex;
+        double step_size;
+        int direction;
+        int failures;
+        bool probing;
+        bool stopped;
+        T base;
+        double base_score;
+        T current;                              // the value set for the interval being measured
+        unsigned long long current_version;     // the option version once it was set
+        std::vector< Decision > decisions;
+        size_t capacity;
+        size_t first;
+
+        // Background thread
+        std::mutex thread_mutex;
+        std::condition_variable wake;
+        bool running;
+        std::thread thread;
+    };
+}
+
+#endif //INCFG_INCFG_TUNER_HPP
@@ -0,0 +1,200 @@
+/*!
+    incfg duration and byte-size option types (See incfg.hpp for description/usage)
+--------------------------------------------------------------------------------
+
+The MIT License
+Copyright (c) 2015 Filippo Bergamasco
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef INCFG_INCFG_UNITS_HPP
+#define INCFG_INCFG_UNITS_HPP
+
+#include "incfg.hpp"
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+
+/*! \file incfg_units.hpp
+ * \brief Duration and byte-size option types
+ *
+ * Values are written as a number followed by a unit, like ```250ms``` or ```1.5GiB```, and are
+ * parsed with std::from_chars (no iostreams involved). When a configuration string is
+ * generated, they are written with the largest unit representing them exactly.
+ *
+ * Duration units: ```ns```, ```us```, ```ms```, ```s```, ```min``` (or ```m```), ```h```, ```d```.
+ * A number without unit is a count of ticks of the option duration type.
+ *
+ * Byte-size units: ```B```, ```kB```, ```MB```, ```GB```, ```TB```, ```PB``` (powers of 1000),
+ * ```KiB```, ```MiB```, ```GiB```, ```TiB```, ```PiB``` (powers of 1024). The single letters ```K```,
+ * ```M```, ```G```, ```T```, ```P``` are accepted as powers of 1024 too. A number without unit is
+ * a count of bytes.
+ */
+
+namespace incfg
+{
+    /*!
+     * \brief A size in bytes, stored as an unsigned 64-bit count
+     */
+    class ByteSize
+    {
+    public:
+        constexpr ByteSize() : bytes( 0 ) {}
+        constexpr explicit ByteSize( unsigned long long _bytes ) : bytes( _bytes ) {}
+
+        /*!
+         * \brief returns the number of bytes
+         */
+        constexpr unsigned long long count() const { return bytes; }
+
+        constexpr bool operator==( const ByteSize& other ) const { return bytes==other.bytes; }
+        constexpr bool operator!=( const ByteSize& other ) const { return bytes!=other.bytes; }
+
+    private:
+        unsigned long long bytes;
+    };
+
+    static_assert( std::is_trivially_copyable< ByteSize >::value, "ByteSize must be trivially copyable" );
+    static_assert( std::is_trivially_copyable< std::chrono::milliseconds >::value, "durations must be trivially copyable" );
+
+
+    namespace detail
+    {
+        // Converts a value in base units (or in ticks if not has_unit) to a count of type Rep
+        template <typename Rep>
+        Expected< Rep > quantity_to_count( const std::string& str, long double value )
+        {
+            if constexpr ( std::is_integral< Rep >::value )
+            {
+                const long double rounded = std::round( value );
+                if( std::fabs( value-rounded ) > 1E-9L*std::fmax( 1.0L, std::fabs(value) ) )
+                    return Unexpected("Unable to parse "+str+": not a whole number of the option unit");
+
+                if( rounded < static_cast< long double >( std::numeric_limits< Rep >::lowest() ) ||
+                    rounded > static_cast< long double >( std::numeric_limits< Rep >::max() ) )
+                    return Unexpected("Unable to parse "+str+": value out of range");
+
+                return static_cast< Rep >( rounded );
+            }
+            return static_cast< Rep >( value );
+        }
+
+
+        template <typename Rep, typename Period>
+        Expected< std::chrono::duration< Rep, Period > > duration_from_string( const std::string& str )
+        {
+            long double value;
+            bool has_unit;
+            if( !parse_quantity( str, QUANTITY_DURATION, value, has_unit ) )
+                return Unexpected("Unable to parse "+str+" to a duration");
+
+            // nanoseconds to ticks of Period
+            if( has_unit )
+                value = value * Period::den / ( Period::num * 1E9L );
+
+            const Expected< Rep > count = quantity_to_count< Rep >( str, value );
+            if( !count )
+                return Unexpected( count.error() );
+
+            return std::chrono::duration< Rep, Period >( *count );
+        }
+
+
+        template <typename Rep, typename Period>
+        std::string duration_to_string( const std::chrono::duration< Rep, Period >& val )
+        {
+            return format_quantity( static_cast< long double >( val.count() ) * Period::num * 1E9L / Period::den, QUANTITY_DURATION );
+        }
+    }
+
+
+#define INCFG_DECLARE_DURATION_CONVERSIONS( TYPE ) \
+    template < > \
+    inline std::string to_string_helper< TYPE >( TYPE val ) \
+    { \
+        return detail::duration_to_string( val ); \
+    } \
+    template < > \
+    inline Expected< TYPE > parse_value< TYPE >( const std::string& str, const TYPE& mytype ) \
+    { \
+        return detail::duration_from_string< TYPE::rep, TYPE::period >( str ); \
+    } \
+    template < > \
+    inline TYPE from_string_helper< TYPE >( std::string str, const TYPE& mytype ) \
+    { \
+        return detail::value_or_throw( parse_value< TYPE >( str, mytype ) ); \
+    }
+
+    INCFG_DECLARE_DURATION_CONVERSIONS( std::chrono::nanoseconds )
+    INCFG_DECLARE_DURATION_CONVERSIONS( std::chrono::microseconds )
+    INCFG_DECLARE_DURATION_CONVERSIONS( std::chrono::milliseconds )
+    INCFG_DECLARE_DURATION_CONVERSIONS( std::chrono::seconds )
+    INCFG_DECLARE_DURATION_CONVERSIONS( std::chrono::minutes )
+    INCFG_DECLARE_DURATION_CONVERSIONS( std::chrono::hours )
+    INCFG_DECLARE_DURATION_CONVERSIONS( std::chrono::duration< double > )
+
+#undef INCFG_DECLARE_DURATION_CONVERSIONS
+
+
+    template < >
+    inline std::string to_string_helper< ByteSize >( ByteSize val )
+    {
+        return detail::format_quantity( static_cast< long double >( val.count() ), detail::QUANTITY_BYTES );
+    }
+
+    template < >
+    inline Expected< ByteSize > parse_value< ByteSize >( const std::string& str, const ByteSize& mytype )
+    {
+        long double value;
+        bool has_unit;
+        if( !detail::parse_quantity( str, detail::QUANTITY_BYTES, value, has_unit ) )
+            return Unexpected("Unable to parse "+str+" to a size in bytes");
+
+        const Expected< unsigned long long > count = detail::quantity_to_count< unsigned long long >( str, value );
+        if( !count )
+            return Unexpected( count.error() );
+
+        return ByteSize( *count );
+    }
+
+    template < >
+    inline ByteSize from_string_helper< ByteSize >( std::string str, const ByteSize& mytype )
+    {
+        return detail::value_or_throw( parse_value< ByteSize >( str, mytype ) );
+    }
+
+
+#ifndef INCFG_HEADER_ONLY
+    // Options of the unit types are instantiated once in incfg.cpp, as those of the fundamental types
+    INCFG_EXTERN_TYPED_OPTION( std::chrono::nanoseconds )
+    INCFG_EXTERN_TYPED_OPTION( std::chrono::microseconds )
+    INCFG_EXTERN_TYPED_OPTION( std::chrono::milliseconds )
+    INCFG_EXTERN_TYPED_OPTION( std::chrono::seconds )
+    INCFG_EXTERN_TYPED_OPTION( std::chrono::minutes )
+    INCFG_EXTERN_TYPED_OPTION( std::chrono::hours )
+    INCFG_EXTERN_TYPED_OPTION( std::chrono::duration< double > )
+    INCFG_EXTERN_TYPED_OPTION( ByteSize )
+#endif
+}
+
+#endif //INCFG_INCFG_UNITS_HPP
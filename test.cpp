@@ -1,6 +1,30 @@
 #define CATCH_CONFIG_MAIN
 #include "catch.hpp"
 #include "incfg.hpp"
+#include "incfg_units.hpp"
+#include "incfg_tuner.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+struct Point
+{
+    int x;
+    int y;
+    bool operator==( const Point& other ) const { return x==other.x && y==other.y; }
+};
+
+std::ostream& operator<<( std::ostream& os, const Point& p ) { return os << p.x << "," << p.y; }
+std::istream& operator>>( std::istream& is, Point& p ) { char sep; return is >> p.x >> sep >> p.y; }
 
 // All incfg requirements must be in the global scope
 //
@@ -9,6 +33,46 @@ INCFG_REQUIRE( double, opt2, 20.1, "option 2")
 INCFG_REQUIRE( std::string, opt3, "opt3!", "option 3")
 INCFG_REQUIRE( bool, opt4, true, "boolean true option")
 INCFG_REQUIRE( bool, opt5, false, "boolean false option")
+INCFG_REQUIRE( std::string, opt6, "say \"hi\"\t", "string option with characters to escape")
+INCFG_REQUIRE( unsigned int, opt7, 7, "unsigned option")
+INCFG_REQUIRE( Point, opt8, Point(), "custom type option")
+
+// opt9 is frozen as if by a header generated with ConfigOptions::to_frozen_header()
+struct incfg_opt9_Tag;
+template < >
+struct incfg::Frozen< incfg_opt9_Tag >
+{
+    static constexpr bool value = true;
+    static constexpr long frozen_value = 64LL;
+};
+
+INCFG_REQUIRE( long, opt9, 32, "frozen option")
+INCFG_REQUIRE( std::chrono::milliseconds, opt10, std::chrono::milliseconds(250), "duration option")
+INCFG_REQUIRE( incfg::ByteSize, opt11, incfg::ByteSize(4096), "byte size option")
+INCFG_REQUIRE( int, opt12, 0, "option read together with opt13")
+INCFG_REQUIRE( std::string, opt13, "0", "option read together with opt12")
+INCFG_REQUIRE( bool, opt14, false, "option selecting a function variant")
+INCFG_REQUIRE( bool, opt15, false, "option selecting a function variant")
+
+enum class Mode { Fast, Safe, Debug, Trace };
+INCFG_ENUM( Mode, "fast", "safe", "debug", "trace" )
+INCFG_REQUIRE( Mode, opt16, Mode::Safe, "enum option" )
+INCFG_REQUIRE( int, opt17, 17, "startup-only option" )
+INCFG_REQUIRE( unsigned int, opt18, incfg::hardware().cpus(), "option defaulting to the usable CPUs" )
+
+struct Settings : incfg::BoundStruct
+{
+    int threads;
+    std::string name;
+    bool verbose;
+    Mode mode;
+    long frozen;
+};
+INCFG_BIND( Settings, threads, opt1 )
+INCFG_BIND( Settings, name, opt3 )
+INCFG_BIND( Settings, verbose, opt4 )
+INCFG_BIND( Settings, mode, opt16 )
+INCFG_BIND( Settings, frozen, opt9 )
 
 
 SCENARIO("Requiring/Getting options", "[Basic]")
@@ -18,6 +82,33 @@ SCENARIO("Requiring/Getting options", "[Basic]")
     {
         REQUIRE( INCFG_GET(opt1)==10 );
         REQUIRE( INCFG_GET(opt2)==20.1 );
+
+        THEN( "Requiring them again with another type should fail" )
+        {
+            REQUIRE( incfg::ConfigOptions::instance().check_type( "opt1", &incfg::detail::TypeId< int >::id ) );
+            REQUIRE_THROWS_AS( incfg::ConfigOptions::instance().check_type( "opt1", &incfg::detail::TypeId< long >::id ), std::logic_error );
+            REQUIRE_THROWS_AS( incfg::TypedOption< double >( "opt2", 0.0, "same key, same type" ), std::logic_error );
+            REQUIRE_THROWS_AS( incfg::TypedOption< float >( "opt2", 0.0f, "same key, other type" ), std::logic_error );
+        }
+    }
+}
+
+
+SCENARIO("Custom option types", "[Custom]")
+{
+    GIVEN( "An option of a type with stream operators" )
+    {
+        WHEN("Command line is parsed")
+        {
+            const char* argv[] = {"exename", "--opt8", "3,4"};
+            incfg::ConfigOptions::instance().load( 3, const_cast< char** >( argv ) );
+            THEN("Value should be parsed via its stream operator")
+            {
+                REQUIRE( INCFG_GET(opt8).x==3 );
+                REQUIRE( INCFG_GET(opt8).y==4 );
+                REQUIRE( incfg::ConfigOptions::instance().get("opt8")->get_value_as_str()=="3,4" );
+            }
+        }
     }
 }
 
@@ -194,6 +285,137 @@ SCENARIO("Config String parsing", "[ConfigParse]")
 }
 
 
+SCENARIO("Tokenizing the text format", "[Tokenizer]")
+{
+    GIVEN( "Lines with whitespace, comments and quoted values" )
+    {
+        WHEN("An unquoted value contains spaces")
+        {
+            std::string confstr( "  # a comment\n\n   \t\nopt3 =  hello   world \t\r\nopt8 = 5, 6\n");
+            incfg::ConfigOptions::instance().load( confstr );
+            THEN("Inner spaces should be kept and surrounding whitespace trimmed")
+            {
+                REQUIRE( INCFG_GET(opt3)=="hello   world" );
+                REQUIRE( INCFG_GET(opt8).x==5 );
+                REQUIRE( INCFG_GET(opt8).y==6 );
+            }
+        }
+        WHEN("A quoted value contains escapes")
+        {
+            std::string confstr( "opt3=\"say \\\"hi\\\"\\n C:\\\\dir \\q\"  \r\n");
+            incfg::ConfigOptions::instance().load( confstr );
+            THEN("Escapes should be decoded")
+            {
+                REQUIRE( INCFG_GET(opt3)=="say \"hi\"\n C:\\dir \\q" );
+            }
+        }
+        WHEN("A string with special characters is written and loaded back")
+        {
+            const std::string value( "line1\nline2\r \"quoted\" back\\slash\t" );
+            INCFG_SET( opt6, value );
+            std::string conf = incfg::ConfigOptions::instance().to_config_string();
+            INCFG_SET( opt6, std::string("") );
+            incfg::ConfigOptions::instance().load( conf );
+            THEN("The value should be the same")
+            {
+                REQUIRE( INCFG_GET(opt6)==value );
+                INCFG_SET( opt6, std::string("say \"hi\"\t") );
+            }
+        }
+        WHEN("Lines are malformed")
+        {
+            THEN("Exception should be thrown")
+            {
+                std::string confstr( "opt3=\"unterminated\n");
+                REQUIRE_THROWS_AS( incfg::ConfigOptions::instance().load( confstr ), incfg::ConfigOptionsLoadException );
+                confstr = "opt3=\"a\" b\n";
+                REQUIRE_THROWS_AS( incfg::ConfigOptions::instance().load( confstr ), incfg::ConfigOptionsLoadException );
+                confstr = "opt3 b = 1\n";
+                REQUIRE_THROWS_AS( incfg::ConfigOptions::instance().load( confstr ), incfg::ConfigOptionsLoadException );
+                confstr = "opt3\n";
+                REQUIRE_THROWS_AS( incfg::ConfigOptions::instance().load( confstr ), incfg::ConfigOptionsLoadException );
+                confstr = " = 1\n";
+                REQUIRE_THROWS_AS( incfg::ConfigOptions::instance().load( confstr ), incfg::ConfigOptionsLoadException );
+            }
+        }
+    }
+}
+
+
+SCENARIO("Incremental parsing", "[Parser]")
+{
+    GIVEN( "A configuration split in small chunks" )
+    {
+        const std::string conf( "# comment\nopt1 = 77\nopt3 = \"split \\\" value\"\r\nopt2=12.5" );
+
+        WHEN("It is fed one byte at a time")
+        {
+            incfg::Parser parser;
+            const int opt1_before = INCFG_GET(opt1);
+            const unsigned long long version = incfg::ConfigOptions::instance().version();
+            for( size_t i=0; i<conf.length(); ++i )
+                parser.feed( conf.data()+i, 1 );
+
+            THEN("Options should be staged as their line completes, and published together by finish()")
+            {
+                REQUIRE( parser.lines()==3 );
+                REQUIRE( INCFG_GET(opt1)==opt1_before );
+                REQUIRE( incfg::ConfigOptions::instance().version()==version );
+
+                parser.finish();
+                REQUIRE( incfg::ConfigOptions::instance().version()==version+1 );
+                REQUIRE( INCFG_GET(opt1)==77 );
+                REQUIRE( INCFG_GET(opt3)=="split \" value" );
+                REQUIRE( INCFG_GET(opt2)==12.5 );
+            }
+        }
+        WHEN("A line exceeds the maximum line length")
+        {
+            incfg::Parser parser( incfg::ConfigOptions::instance(), 8 );
+            THEN("Exception should be thrown")
+            {
+                REQUIRE_THROWS_AS( parser.feed( conf.data(), conf.length() ), incfg::ConfigOptionsLoadException );
+            }
+        }
+#if defined(__unix__) || defined(__APPLE__)
+        WHEN("It is read from a pipe")
+        {
+            int fds[2];
+            REQUIRE( pipe( fds )==0 );
+            const std::string piped( "opt1 = 78\nopt2 = 13.5\n" );
+            REQUIRE( write( fds[1], piped.data(), piped.length() )==static_cast< ssize_t >( piped.length() ) );
+            close( fds[1] );
+            incfg::ConfigOptions::instance().load_fd( fds[0] );
+            close( fds[0] );
+
+            THEN("Options should be loaded")
+            {
+                REQUIRE( INCFG_GET(opt1)==78 );
+                REQUIRE( INCFG_GET(opt2)==13.5 );
+            }
+        }
+        WHEN("A pipe sends a line longer than the limit")
+        {
+            int fds[2];
+            REQUIRE( pipe( fds )==0 );
+            const std::string piped( "opt1 = 79\nopt2 = 14.5000000000000000\n" );
+            REQUIRE( write( fds[1], piped.data(), piped.length() )==static_cast< ssize_t >( piped.length() ) );
+            close( fds[1] );
+            const incfg::Status status = incfg::ConfigOptions::instance().try_load_fd( fds[0], 16 );
+            close( fds[0] );
+
+            THEN("The load should fail at that line")
+            {
+                REQUIRE( status.code==incfg::Errc::line_too_long );
+                REQUIRE( status.line==2 );
+                REQUIRE( INCFG_GET(opt2)!=14.5 );
+            }
+        }
+#endif
+    }
+}
+
+
 SCENARIO("Loading a self-generated config string", "[ConfigParseSelf]")
 {
     GIVEN("ALL Options changed from default value");
@@ -225,10 +447,10 @@ SCENARIO("Loading from command line", "[CmdLine]" )
 {
     GIVEN("opt1 given correctly from command line")
     {
-        char* argv[] = {"exename", "--opt1", "4"};
+        const char* argv[] = {"exename", "--opt1", "4"};
         WHEN("Command line is parsed")
         {
-            incfg::ConfigOptions::instance().load( 3, argv );
+            incfg::ConfigOptions::instance().load( 3, const_cast< char** >( argv ) );
             THEN("opt1 should be parsed correctly")
             {
                 REQUIRE(INCFG_GET(opt1)==4);
@@ -238,13 +460,13 @@ SCENARIO("Loading from command line", "[CmdLine]" )
 
     GIVEN("opt1 given with no value from command line")
     {
-        char* argv[] = {"exename", "--opt1", "--opt2"};
+        const char* argv[] = {"exename", "--opt1", "--opt2"};
         WHEN("Command line is parsed")
         {
             THEN("opt1 should not be parsed correctly")
             {
                 try{
-                    incfg::ConfigOptions::instance().load( 3, argv );
+                    incfg::ConfigOptions::instance().load( 3, const_cast< char** >( argv ) );
                     REQUIRE(false);
                 }catch(...)
                 {
@@ -256,13 +478,13 @@ SCENARIO("Loading from command line", "[CmdLine]" )
 
     GIVEN("opt1 given with a bad value from command line")
     {
-        char* argv[] = {"exename", "--opt1", "a"};
+        const char* argv[] = {"exename", "--opt1", "a"};
         WHEN("Command line is parsed")
         {
             THEN("opt1 should not be parsed correctly")
             {
                 try{
-                    incfg::ConfigOptions::instance().load( 3, argv );
+                    incfg::ConfigOptions::instance().load( 3, const_cast< char** >( argv ) );
                     REQUIRE(false);
                 }catch(...)
                 {
@@ -274,13 +496,13 @@ SCENARIO("Loading from command line", "[CmdLine]" )
 
     GIVEN("string option given from command line")
     {
-        char* argv[] = {"exename", "--opt3", "test"};
+        const char* argv[] = {"exename", "--opt3", "test"};
         WHEN("Command line is parsed")
         {
             THEN("option should be parsed correctly")
             {
                 try{
-                    incfg::ConfigOptions::instance().load( 3, argv );
+                    incfg::ConfigOptions::instance().load( 3, const_cast< char** >( argv ) );
                     REQUIRE(true);
                 }catch( std::runtime_error& ex )
                 {
@@ -292,3 +514,1073 @@ SCENARIO("Loading from command line", "[CmdLine]" )
 
     }
 }
+
+
+SCENARIO("Dumping the configuration", "[Dump]")
+{
+    GIVEN("Some options with a known value")
+    {
+        INCFG_SET(opt1,-12);
+        INCFG_SET(opt4,true);
+
+        WHEN("The JSON dump is generated")
+        {
+            std::string json = incfg::ConfigOptions::instance().to_json();
+            THEN("Values should be properly typed")
+            {
+                REQUIRE( json[0]=='{' );
+                REQUIRE( json[json.length()-1]=='}' );
+                REQUIRE( json.find("\"opt1\":-12") != std::string::npos );
+                REQUIRE( json.find("\"opt4\":true") != std::string::npos );
+                REQUIRE( json.find("\"opt7\":7") != std::string::npos );
+            }
+            THEN("Strings should be escaped")
+            {
+                REQUIRE( json.find("\"opt6\":\"say \\\"hi\\\"\\t\"") != std::string::npos );
+            }
+        }
+
+        WHEN("The binary dump is generated")
+        {
+            std::string bin = incfg::ConfigOptions::instance().to_binary();
+            THEN("Header should contain the number of options")
+            {
+                REQUIRE( bin.compare(0, 6, "INCFGB")==0 );
+                REQUIRE( bin[6]==1 );
+                REQUIRE( static_cast<unsigned char>(bin[7]) == incfg::ConfigOptions::instance().size() );
+            }
+            THEN("Integers should be stored as little-endian i64")
+            {
+                size_t idx = bin.find("opt1");
+                REQUIRE( idx != std::string::npos );
+                REQUIRE( bin[idx+4]==0 );   // flags: not default
+                REQUIRE( bin[idx+5]==1 );   // tag: signed integer
+                REQUIRE( static_cast<unsigned char>(bin[idx+6])==0xF4 );
+                REQUIRE( static_cast<unsigned char>(bin[idx+13])==0xFF );
+            }
+        }
+#if defined(__unix__) || defined(__APPLE__)
+        WHEN("A key is too long for the binary format (in a child process, as options cannot be unregistered)")
+        {
+            const pid_t pid = fork();
+            if( pid == 0 )
+            {
+                const std::string key( 70000, 'k' );
+                static incfg::TypedOption< int > long_key( key.c_str(), 0, "key longer than 65535 bytes" );
+                std::string bin;
+                bool thrown = false;
+                try { bin = incfg::ConfigOptions::instance().to_binary(); } catch( std::length_error& ) { thrown = true; }
+                _exit( thrown && bin.empty() ? 0 : 1 );
+            }
+
+            int status = -1;
+            waitpid( pid, &status, 0 );
+
+            THEN("The dump should be rejected before anything is written")
+            {
+                REQUIRE( WIFEXITED( status ) );
+                REQUIRE( WEXITSTATUS( status ) == 0 );
+            }
+        }
+#endif
+    }
+}
+
+
+SCENARIO("Freezing option values", "[Frozen]")
+{
+    GIVEN("An option frozen at compile time")
+    {
+        static_assert( INCFG_GET(opt9)==64, "frozen options must be compile-time constants" );
+
+        THEN("Its runtime value should be the frozen one")
+        {
+            REQUIRE( incfg::ConfigOptions::instance().get("opt9")->is_frozen() );
+            REQUIRE( incfg::ConfigOptions::instance().get("opt9")->get_value_as_str()=="64" );
+            REQUIRE( !incfg::ConfigOptions::instance().get("opt9")->is_default() );
+        }
+        WHEN("Config string is parsed with the frozen value")
+        {
+            std::string confstr( "opt9=64\n");
+            THEN("Parse should be successful")
+            {
+                incfg::ConfigOptions::instance().load( confstr );
+            }
+        }
+        WHEN("Config string is parsed with a different value")
+        {
+            std::string confstr( "opt9=65\n");
+            THEN("Exception should be thrown")
+            {
+                REQUIRE_THROWS_AS( incfg::ConfigOptions::instance().load( confstr ), incfg::ConfigOptionsLoadException );
+            }
+        }
+    }
+
+    GIVEN("A frozen header generated from the current configuration")
+    {
+        INCFG_SET(opt1,-12);
+        INCFG_SET(opt2,1.5);
+        std::string header = incfg::ConfigOptions::instance().to_frozen_header();
+
+        THEN("Options of fundamental types should be frozen to their current value")
+        {
+            REQUIRE( header.find("struct incfg::Frozen< incfg_opt1_Tag >") != std::string::npos );
+            REQUIRE( header.find("static constexpr int frozen_value = -12LL;") != std::string::npos );
+            REQUIRE( header.find("static constexpr double frozen_value = 1.5;") != std::string::npos );
+            REQUIRE( header.find("static constexpr unsigned int frozen_value = 7ULL;") != std::string::npos );
+        }
+        THEN("Other options should not be frozen")
+        {
+            REQUIRE( header.find("incfg_opt3_Tag") == std::string::npos );
+            REQUIRE( header.find("incfg_opt8_Tag") == std::string::npos );
+        }
+    }
+}
+
+
+SCENARIO("Duration and byte-size options", "[Units]")
+{
+    GIVEN("A duration option")
+    {
+        THEN("Default value should be written with its unit")
+        {
+            REQUIRE( incfg::ConfigOptions::instance().to_config_string().find("#opt10=250ms") != std::string::npos );
+        }
+        WHEN("Values with units are parsed")
+        {
+            THEN("They should be converted to the option unit")
+            {
+                std::string confstr( "opt10=1.5s\n");
+                incfg::ConfigOptions::instance().load( confstr );
+                REQUIRE( INCFG_GET(opt10).count()==1500 );
+                REQUIRE( incfg::ConfigOptions::instance().get("opt10")->get_value_as_str()=="1500ms" );
+
+                confstr = "opt10=2min\n";
+                incfg::ConfigOptions::instance().load( confstr );
+                REQUIRE( INCFG_GET(opt10).count()==120000 );
+                REQUIRE( incfg::ConfigOptions::instance().get("opt10")->get_value_as_str()=="2min" );
+
+                confstr = "opt10=40\n";
+                incfg::ConfigOptions::instance().load( confstr );
+                REQUIRE( INCFG_GET(opt10).count()==40 );
+            }
+        }
+        WHEN("Values are not a whole number of the option unit or have an unknown unit")
+        {
+            THEN("Exception should be thrown")
+            {
+                std::string confstr( "opt10=1.5us\n");
+                REQUIRE_THROWS_AS( incfg::ConfigOptions::instance().load( confstr ), incfg::StringParseException );
+                confstr = "opt10=3parsecs\n";
+                REQUIRE_THROWS_AS( incfg::ConfigOptions::instance().load( confstr ), incfg::StringParseException );
+            }
+        }
+    }
+
+    GIVEN("A byte-size option")
+    {
+        THEN("Default value should be written with its unit")
+        {
+            REQUIRE( incfg::ConfigOptions::instance().to_config_string().find("#opt11=4KiB") != std::string::npos );
+        }
+        WHEN("Values with units are parsed")
+        {
+            THEN("They should be converted to bytes")
+            {
+                std::string confstr( "opt11=1.5GiB\n");
+                incfg::ConfigOptions::instance().load( confstr );
+                REQUIRE( INCFG_GET(opt11).count()==1610612736ULL );
+                REQUIRE( incfg::ConfigOptions::instance().get("opt11")->get_value_as_str()=="1536MiB" );
+
+                confstr = "opt11=2kB\n";
+                incfg::ConfigOptions::instance().load( confstr );
+                REQUIRE( INCFG_GET(opt11).count()==2000 );
+                REQUIRE( incfg::ConfigOptions::instance().get("opt11")->get_value_as_str()=="2kB" );
+
+                confstr = "opt11=1000\n";
+                incfg::ConfigOptions::instance().load( confstr );
+                REQUIRE( INCFG_GET(opt11).count()==1000 );
+                REQUIRE( incfg::ConfigOptions::instance().get("opt11")->get_value_as_str()=="1kB" );
+            }
+        }
+        WHEN("A negative value is parsed")
+        {
+            THEN("Exception should be thrown")
+            {
+                std::string confstr( "opt11=-1KiB\n");
+                REQUIRE_THROWS_AS( incfg::ConfigOptions::instance().load( confstr ), incfg::StringParseException );
+            }
+        }
+    }
+}
+
+
+SCENARIO("Published options and NUMA replicas", "[Publish]")
+{
+    GIVEN("A published option")
+    {
+        incfg::ConfigOptions& co = incfg::ConfigOptions::instance();
+
+        WHEN("It is set")
+        {
+            const unsigned long long version = co.version();
+            INCFG_SET( opt7, 8u );
+
+            THEN("A new version should be published")
+            {
+                REQUIRE( co.version()==version+1 );
+                REQUIRE( INCFG_GET(opt7)==8u );
+            }
+        }
+#if defined(__unix__) || defined(__APPLE__)
+        WHEN("Replicas are enabled on an emulated topology (in a child process, as they cannot be disabled)")
+        {
+            const pid_t pid = fork();
+            if( pid == 0 )
+            {
+                bool ok = true;
+                co.enable_numa_replicas( 2 );
+                ok = ok && co.numa_replicas()==2;
+                try { co.enable_numa_replicas( 2 ); ok = false; } catch( std::logic_error& ) {}
+
+                // Reads are served by the replicas with the current values
+                ok = ok && co.local_replica()!=0 && INCFG_GET(opt7)==8u;
+                INCFG_SET( opt7, 9u );
+                ok = ok && INCFG_GET(opt7)==9u;
+
+                std::string confstr( "opt1=42\nopt10=3s\n" );
+                co.load( confstr );
+                ok = ok && INCFG_GET(opt1)==42 && INCFG_GET(opt10)==std::chrono::seconds(3);
+                ok = ok && co.get("opt1")->get_value_as_str()=="42";
+                _exit( ok ? 0 : 1 );
+            }
+
+            int status = -1;
+            waitpid( pid, &status, 0 );
+
+            THEN("Reads should be served by the replicas with the current values")
+            {
+                REQUIRE( WIFEXITED( status ) );
+                REQUIRE( WEXITSTATUS( status ) == 0 );
+                REQUIRE( co.numa_replicas()==0 );
+            }
+        }
+#endif
+    }
+}
+
+
+SCENARIO("Memory usage accounting", "[Memory]")
+{
+    GIVEN("The registered options")
+    {
+        incfg::ConfigOptions& co = incfg::ConfigOptions::instance();
+        const incfg::MemoryUsage before = co.memory_usage();
+        REQUIRE( before.options >= co.size()*sizeof(incfg::Option) );
+        REQUIRE( before.registry > 0 );
+        REQUIRE( before.descriptions > 0 );
+
+        WHEN("A string option is set to a long value")
+        {
+            const std::string long_value( 1000, 'x' );
+            INCFG_SET( opt3, long_value );
+
+            THEN("Its heap bytes should be accounted")
+            {
+                const incfg::MemoryUsage after = co.memory_usage();
+                REQUIRE( after.string_values > long_value.length() );
+                REQUIRE( after.total() > before.total() );
+
+                INCFG_SET( opt3, std::string("short") );
+                size_t string_values = 0;
+                for( size_t i=0; i<co.size(); ++i )
+                    string_values += co.option_by_index( i )->value_heap_bytes();
+                REQUIRE( co.memory_usage().string_values == string_values );
+            }
+        }
+        WHEN("A string option read by copy is replaced")
+        {
+            const std::string copy = INCFG_GET( opt3 );
+            INCFG_SET( opt3, std::string( 1000, 'a' ) );
+            INCFG_SET( opt3, std::string( 1000, 'b' ) );
+
+            THEN("Replaced values should be freed by the next publication")
+            {
+                REQUIRE( co.memory_usage().history < 1000 );
+            }
+        }
+        WHEN("A string option referenced within a read section is replaced")
+        {
+            std::string value;
+            size_t kept = 0;
+            bool referenced = false;
+            {
+                const incfg::ConfigOptions::ReadSection section;
+                const std::string& reference = std::get<0>( incfg::get_consistent( section, INCFG_OPTION( opt3 ) ) );
+                value = reference;
+                INCFG_SET( opt3, std::string( 1000, 'a' ) );
+                INCFG_SET( opt3, std::string( 1000, 'b' ) );
+                kept = co.memory_usage().history;
+                referenced = reference == value;
+            }
+
+            THEN("Replaced values should be kept until the section ends")
+            {
+                REQUIRE( kept >= 1000 );
+                REQUIRE( referenced );
+
+                INCFG_SET( opt3, std::string("short") );
+                REQUIRE( co.memory_usage().history + 1000 <= kept );
+            }
+        }
+        WHEN("More threads than INCFG_MAX_READER_THREADS read strings")
+        {
+            // The main thread holds a slot, the others are held by threads blocked in a read section
+            { const incfg::ConfigOptions::ReadSection section; }
+            std::mutex mutex;
+            std::condition_variable cv;
+            size_t pinned = 0;
+            bool release = false;
+            std::vector< std::thread > readers;
+            for( size_t i=1; i<INCFG_MAX_READER_THREADS; ++i )
+            {
+                readers.push_back( std::thread( [&]()
+                {
+                    const incfg::ConfigOptions::ReadSection section;
+                    std::unique_lock< std::mutex > lock( mutex );
+                    ++pinned;
+                    cv.notify_all();
+                    cv.wait( lock, [&]() { return release; } );
+                } ) );
+            }
+            {
+                std::unique_lock< std::mutex > lock( mutex );
+                cv.wait( lock, [&]() { return pinned == readers.size(); } );
+            }
+
+            const std::string value = INCFG_GET( opt3 );
+            std::string copy;
+            std::thread( [&]() { copy = INCFG_GET( opt3 ); } ).join();
+            {
+                std::lock_guard< std::mutex > lock( mutex );
+                release = true;
+            }
+            cv.notify_all();
+            for( size_t i=0; i<readers.size(); ++i )
+                readers[i].join();
+
+            INCFG_SET( opt3, std::string( 1000, 'a' ) );
+            INCFG_SET( opt3, std::string( 1000, 'b' ) );
+
+            THEN("The others should read under the writer lock, and replaced values should still be freed")
+            {
+                REQUIRE( copy == value );
+                REQUIRE( co.memory_usage().history < 1000 );
+            }
+        }
+    }
+}
+
+
+SCENARIO("Consistent multi-option reads", "[Consistent]")
+{
+    GIVEN("Options always published together")
+    {
+        WHEN("They are read while a writer publishes new versions")
+        {
+            bool consistent = true;
+            std::thread writer( []()
+            {
+                for( int i=1; i<=20000; ++i )
+                {
+                    incfg::ConfigOptions::Publication publication( incfg::ConfigOptions::instance() );
+                    INCFG_SET( opt12, i );
+                    INCFG_SET( opt13, std::to_string( i ) );
+                }
+            } );
+
+            int last = 0;
+            while( last < 20000 )
+            {
+                auto [num, str, frozen] = incfg::get_consistent( INCFG_OPTION( opt12 ), INCFG_OPTION( opt13 ), INCFG_OPTION( opt9 ) );
+                consistent = consistent && std::to_string( num )==str && frozen==64;
+                last = num;
+            }
+            writer.join();
+
+            THEN("Every read should come from a single version")
+            {
+                REQUIRE( consistent );
+                REQUIRE( std::get<1>( incfg::get_consistent( incfg_opt12_Option_instance, incfg_opt13_Option_instance ) )=="20000" );
+            }
+        }
+    }
+}
+
+
+struct Variant
+{
+    template <bool A, bool B>
+    static int run( int x ) { return x * 100 + A * 10 + B; }
+};
+
+
+SCENARIO("Function multiversioning", "[Multiversion]")
+{
+    GIVEN("A function specialized for two bool options")
+    {
+        static auto variant = incfg::multiversion< Variant, int (*)( int ) >( INCFG_OPTION( opt14 ), INCFG_OPTION( opt15 ) );
+        REQUIRE( variant.count == 4 );
+        REQUIRE( variant( 1 ) == 100 );
+
+        WHEN("The options are published")
+        {
+            INCFG_SET( opt14, true );
+            const int first = variant( 2 );
+            {
+                incfg::ConfigOptions::Publication publication( incfg::ConfigOptions::instance() );
+                INCFG_SET( opt14, false );
+                INCFG_SET( opt15, true );
+            }
+            const int second = variant( 3 );
+            std::string config = "opt14 = true\n";
+            incfg::ConfigOptions::instance().load( config );
+            const int third = variant.get()( 4 );
+            INCFG_SET( opt14, false );
+            INCFG_SET( opt15, false );
+
+            THEN("The variant matching the new values should be called")
+            {
+                REQUIRE( first == 210 );
+                REQUIRE( second == 301 );
+                REQUIRE( third == 411 );
+                REQUIRE( variant( 5 ) == 500 );
+            }
+        }
+        WHEN("Another function is specialized")
+        {
+            const unsigned long long version = incfg::ConfigOptions::instance().version();
+            auto other = incfg::multiversion< Variant, int (*)( int ) >( INCFG_OPTION( opt14 ), INCFG_OPTION( opt15 ) );
+
+            THEN("No version should be published")
+            {
+                REQUIRE( other( 1 ) == 100 );
+                REQUIRE( incfg::ConfigOptions::instance().version() == version );
+            }
+        }
+    }
+}
+
+
+SCENARIO("Batched sets", "[Batch]")
+{
+    GIVEN("A batch of sets")
+    {
+        incfg::ConfigOptions& co = incfg::ConfigOptions::instance();
+        const unsigned long long version = co.version();
+        incfg::Batch batch;
+        INCFG_BATCH_SET( batch, opt12, 42 );
+        INCFG_BATCH_SET( batch, opt13, std::string("42") );
+        INCFG_BATCH_SET( batch, opt12, 43 );
+        REQUIRE( batch.size() == 2 );
+
+        WHEN("It is not committed")
+        {
+            THEN("Nothing should be published")
+            {
+                REQUIRE( co.version() == version );
+                REQUIRE( INCFG_GET( opt12 ) != 43 );
+            }
+        }
+        WHEN("It is committed")
+        {
+            batch.commit();
+
+            THEN("All the values should be published as a single version")
+            {
+                REQUIRE( co.version() == version+1 );
+                REQUIRE( batch.size() == 0 );
+                REQUIRE( INCFG_GET( opt12 ) == 43 );
+                REQUIRE( INCFG_GET( opt13 ) == "42" );
+
+                batch.commit();
+                REQUIRE( co.version() == version+1 );
+            }
+        }
+    }
+}
+
+SCENARIO("Sealed options", "[Seal]")
+{
+    GIVEN("A startup-only option")
+    {
+        incfg::ConfigOptions& co = incfg::ConfigOptions::instance();
+        REQUIRE_THROWS_AS( co.seal( { "opt17", "unknown" } ), std::invalid_argument );
+        REQUIRE( !co.get( "opt17" )->is_sealed() );
+        INCFG_SET( opt17, 18 );
+
+        WHEN("It is sealed")
+        {
+            co.seal( { "opt17" } );
+
+            THEN("It can no longer be changed, unlike the other options")
+            {
+                REQUIRE( co.get( "opt17" )->is_sealed() );
+                REQUIRE( !co.is_sealed() );
+                const unsigned long long version = co.version();
+                REQUIRE_THROWS_AS( INCFG_SET( opt17, 19 ), std::logic_error );
+                REQUIRE( co.version() == version );
+
+                const int opt12 = INCFG_GET( opt12 );
+                std::string config = "opt12 = " + std::to_string( opt12+1 ) + "\nopt17 = 20\n";
+                REQUIRE_THROWS_AS( co.load( config ), std::logic_error );
+                REQUIRE( INCFG_GET( opt17 ) == 18 );
+                REQUIRE( INCFG_GET( opt12 ) == opt12 );
+                REQUIRE( co.version() == version );
+
+                incfg::Batch batch;
+                INCFG_BATCH_SET( batch, opt12, opt12+1 );
+                INCFG_BATCH_SET( batch, opt17, 21 );
+                REQUIRE( batch.try_commit().code == incfg::Errc::sealed );
+                REQUIRE( INCFG_GET( opt12 ) == opt12 );
+                REQUIRE( co.version() == version );
+
+                // It can still be set to its current value
+                INCFG_SET( opt17, 18 );
+                config = "opt17 = 18\nopt12 = " + std::to_string( opt12+1 ) + "\n";
+                co.load( config );
+                REQUIRE( co.version() == version+1 );
+                REQUIRE( INCFG_GET( opt12 ) == opt12+1 );
+            }
+        }
+    }
+
+#if defined(__unix__) || defined(__APPLE__)
+    GIVEN("A sealed configuration (in a child process, as it cannot be unsealed)")
+    {
+        const pid_t pid = fork();
+        if( pid == 0 )
+        {
+            incfg::ConfigOptions& co = incfg::ConfigOptions::instance();
+            co.seal();
+            const std::string opt1 = std::to_string( INCFG_GET( opt1 ) ), other = std::to_string( INCFG_GET( opt1 )+1 );
+            int failures = 0;
+            try { INCFG_SET( opt12, INCFG_GET( opt12 )+1 ); } catch( std::logic_error& ) { ++failures; }
+            try { std::string config = "opt1 = " + other + "\n"; co.load( config ); } catch( std::logic_error& ) { ++failures; }
+            try { char* argv[] = { (char*)"test", (char*)"--opt1", (char*)other.c_str() }; co.load( 3, argv ); } catch( std::logic_error& ) { ++failures; }
+            try { static incfg::TypedOption< int > late( "late", 0, "registered after sealing" ); } catch( std::logic_error& ) { ++failures; }
+
+            // Loading the current values succeeds
+            std::string config = "opt1 = " + opt1 + "\n";
+            const bool unchanged = co.try_load( config ).ok();
+            _exit( co.is_sealed() && failures == 4 && unchanged && co.get( "late" ) == 0 ? 0 : 1 );
+        }
+
+        int status = -1;
+        waitpid( pid, &status, 0 );
+
+        THEN("Sets, loads and registrations should fail")
+        {
+            REQUIRE( WIFEXITED( status ) );
+            REQUIRE( WEXITSTATUS( status ) == 0 );
+        }
+    }
+#endif
+}
+
+SCENARIO("Packed bool options", "[Flags]")
+{
+    GIVEN("bool options declared together")
+    {
+        const auto both = incfg::flags( INCFG_OPTION( opt14 ), INCFG_OPTION( opt15 ) );
+        const auto all = incfg::flags( INCFG_OPTION( opt4 ), INCFG_OPTION( opt5 ), INCFG_OPTION( opt14 ), INCFG_OPTION( opt15 ) );
+        REQUIRE( both.words() == 1 );
+        REQUIRE( all.words() == 1 );
+        REQUIRE( both.none() );
+        const bool opt4_value = INCFG_GET( opt4 );
+        const bool opt5_value = INCFG_GET( opt5 );
+
+        WHEN("Their flags are flipped")
+        {
+            INCFG_SET( opt15, true );
+            const bool any = both.any(), all_set = both.all();
+            {
+                incfg::ConfigOptions::Publication publication( incfg::ConfigOptions::instance() );
+                INCFG_SET( opt14, true );
+                INCFG_SET( opt4, true );
+                INCFG_SET( opt5, true );
+            }
+            const bool every = all.all();
+            INCFG_SET( opt4, opt4_value );
+            INCFG_SET( opt5, opt5_value );
+            INCFG_SET( opt14, false );
+            INCFG_SET( opt15, false );
+
+            THEN("The masks should reflect them, without changing the other flags")
+            {
+                REQUIRE( any );
+                REQUIRE( !all_set );
+                REQUIRE( every );
+                REQUIRE( both.none() );
+                REQUIRE( all.any() == ( opt4_value || opt5_value ) );
+                REQUIRE( INCFG_GET( opt4 ) == opt4_value );
+                REQUIRE( INCFG_GET( opt5 ) == opt5_value );
+            }
+        }
+    }
+}
+
+SCENARIO("Enum options", "[Enum]")
+{
+    GIVEN("An enum option")
+    {
+        REQUIRE( INCFG_GET( opt16 ) == Mode::Safe );
+        REQUIRE( incfg::ConfigOptions::instance().get( "opt16" )->get_value_as_str() == "safe" );
+        static_assert( incfg::enum_name( Mode::Debug )[0] == 'd', "enum names should be constant" );
+
+        WHEN("It is loaded by name")
+        {
+            std::string config = "opt16 = trace\n";
+            incfg::ConfigOptions::instance().load( config );
+            const Mode unquoted = INCFG_GET( opt16 );
+            incfg::ConfigOptions::instance().get( "opt16" )->parse_value_from_str( "\"fast\"" );
+            const Mode quoted = INCFG_GET( opt16 );
+
+            THEN("Its value should be the matching enumerator")
+            {
+                REQUIRE( unquoted == Mode::Trace );
+                REQUIRE( quoted == Mode::Fast );
+                REQUIRE( incfg::to_string_helper( Mode::Debug ) == "debug" );
+                REQUIRE( incfg::to_string_helper( static_cast< Mode >( 9 ) ) == "9" );
+
+                for( const char* name : { "safe", "debug", "trace", "fast" } )
+                    REQUIRE( incfg::to_string_helper( incfg::from_string_helper( name, Mode() ) ) == name );
+                REQUIRE_THROWS_AS( incfg::from_string_helper( "Safe", Mode() ), incfg::StringParseException );
+                REQUIRE_THROWS_AS( incfg::from_string_helper( "", Mode() ), incfg::StringParseException );
+                REQUIRE_THROWS_AS( incfg::from_string_helper( "safer", Mode() ), incfg::StringParseException );
+                INCFG_SET( opt16, Mode::Safe );
+            }
+        }
+    }
+}
+
+
+struct EnumVariant
+{
+    template <Mode M>
+    static int run() { return static_cast< int >( M ); }
+};
+
+
+SCENARIO("Function multiversioning on enums", "[Enum]")
+{
+    GIVEN("A function specialized for an enum option")
+    {
+        static auto variant = incfg::multiversion< EnumVariant, int (*)() >( INCFG_OPTION( opt16 ) );
+        REQUIRE( variant.count == 4 );
+
+        WHEN("The option is changed")
+        {
+            INCFG_SET( opt16, Mode::Debug );
+            const int debug = variant();
+            INCFG_SET( opt16, Mode::Safe );
+
+            THEN("The matching variant should be called")
+            {
+                REQUIRE( debug == 2 );
+                REQUIRE( variant() == 1 );
+            }
+        }
+    }
+}
+
+
+#if defined(__unix__) || defined(__APPLE__)
+SCENARIO("Change notifications", "[Notify]")
+{
+    GIVEN("Notification descriptors for a single option and for all the options")
+    {
+        incfg::ConfigOptions& co = incfg::ConfigOptions::instance();
+        const int one = co.notification_fd( { "opt12" } );
+        const int all = co.notification_fd();
+        REQUIRE_THROWS_AS( co.notification_fd( { "unknown" } ), std::invalid_argument );
+
+        struct pollfd fds[2] = { { one, POLLIN, 0 }, { all, POLLIN, 0 } };
+        REQUIRE( poll( fds, 2, 0 ) == 0 );
+
+        WHEN("Other options are changed, and one is set to its current value")
+        {
+            INCFG_SET( opt1, INCFG_GET( opt1 ) + 1 );
+            INCFG_SET( opt2, INCFG_GET( opt2 ) + 1 );
+            INCFG_SET( opt3, INCFG_GET( opt3 ) );
+
+            THEN("Only the descriptor for all the options should be readable, and report the changed options")
+            {
+                REQUIRE( poll( fds, 2, 0 ) == 1 );
+                REQUIRE( fds[1].revents == POLLIN );
+
+                std::vector< std::string > keys;
+                REQUIRE( co.fetch_changes( all, [&]( incfg::Option& opt ) { keys.push_back( opt.name ); } ) == 2 );
+                std::sort( keys.begin(), keys.end() );
+                REQUIRE( keys == std::vector< std::string >{ "opt1", "opt2" } );
+                REQUIRE( poll( fds, 2, 0 ) == 0 );
+            }
+        }
+        WHEN("The option is changed several times")
+        {
+            const int value = INCFG_GET( opt12 );
+            {
+                incfg::ConfigOptions::Publication publication( co );
+                INCFG_SET( opt12, value+1 );
+                INCFG_SET( opt12, value+2 );
+            }
+            INCFG_SET( opt12, value+3 );
+
+            THEN("Both descriptors should be readable, and report the option once")
+            {
+                REQUIRE( poll( fds, 2, 0 ) == 2 );
+                size_t count = 0;
+                REQUIRE( co.fetch_changes( one, [&]( incfg::Option& opt ) { count += &opt == &incfg_opt12_Option_instance; } ) == 1 );
+                REQUIRE( count == 1 );
+                REQUIRE( co.fetch_changes( one, []( incfg::Option& ) {} ) == 0 );
+                REQUIRE( poll( fds, 2, 0 ) == 1 );
+            }
+        }
+
+        co.close_notification_fd( one );
+        co.close_notification_fd( all );
+        REQUIRE_THROWS_AS( co.fetch_changes( one, []( incfg::Option& ) {} ), std::invalid_argument );
+    }
+}
+#endif
+
+
+SCENARIO("Non-throwing conversions and loaders", "[Status]")
+{
+    GIVEN("Options of built-in and custom types")
+    {
+        incfg::ConfigOptions& co = incfg::ConfigOptions::instance();
+        const int opt1 = INCFG_GET( opt1 );
+        const Point opt8 = INCFG_GET( opt8 );
+
+        THEN("Conversions should return the value or the error")
+        {
+            REQUIRE( *incfg::parse_value< int >( "12", 0 ) == 12 );
+            REQUIRE( incfg::parse_value< Point >( "1,2", Point() )->y == 2 );
+            REQUIRE( incfg::parse_value< Mode >( "trace", Mode() ).value() == Mode::Trace );
+            REQUIRE( incfg::parse_value< incfg::ByteSize >( "1KiB", incfg::ByteSize() )->count() == 1024 );
+            REQUIRE( !incfg::parse_value< Point >( "x", Point() ) );
+            REQUIRE( incfg::parse_value< bool >( "1", true ).error() == "Unable to parse 1 to \"true\" or \"false\"" );
+        }
+        WHEN("A configuration with an invalid value is loaded")
+        {
+            const int opt1_before = INCFG_GET( opt1 );
+            const std::string opt8_before = co.get( "opt8" )->get_value_as_str();
+            const incfg::Status status = co.try_load( std::string( "opt1 = 5\nopt8 = 7,8\n\nopt1 = x\nopt1 = 6\n" ) );
+
+            THEN("The error should be returned with its line, and none of the lines applied")
+            {
+                REQUIRE( status.code == incfg::Errc::invalid_value );
+                REQUIRE( status.line == 4 );
+                REQUIRE( std::string( status.message() ) == "Config file error for key <opt1> (Line 4): Unable to parse x to its defined type" );
+                REQUIRE( INCFG_GET( opt1 ) == opt1_before );
+                REQUIRE( co.get( "opt8" )->get_value_as_str() == opt8_before );
+                REQUIRE_THROWS_AS( status.raise(), incfg::StringParseException );
+            }
+        }
+        WHEN("Other errors are returned")
+        {
+            THEN("Each should have its code, and raise the exception of the throwing loaders")
+            {
+                REQUIRE( co.try_load( std::string( "opt1 = 1" ) ).ok() );
+                REQUIRE( std::string( co.try_load( std::string( "opt1 = 1" ) ).message() ) == "Success" );
+                REQUIRE( co.try_load( std::string( "opt9 = 65" ) ).code == incfg::Errc::frozen );
+                REQUIRE( co.try_load( std::string( "unknown = 1" ) ).code == incfg::Errc::unknown_key );
+                REQUIRE( co.try_load( std::string( "opt1 1" ) ).code == incfg::Errc::syntax_error );
+                REQUIRE_THROWS_AS( co.try_load( std::string( "opt1 1" ) ).raise(), incfg::ConfigOptionsLoadException );
+                REQUIRE( !incfg::Status( incfg::Errc::sealed, 0, "sealed" ) );
+                REQUIRE_THROWS_AS( incfg::Status( incfg::Errc::sealed, 0, "sealed" ).raise(), std::logic_error );
+
+                char* argv[] = { (char*)"test", (char*)"--opt1" };
+                const incfg::Status status = co.try_load( 2, argv );
+                REQUIRE( status.code == incfg::Errc::missing_value );
+                REQUIRE( status.line == 1 );
+            }
+        }
+
+        INCFG_SET( opt1, opt1 );
+        INCFG_SET( opt8, opt8 );
+    }
+}
+
+
+SCENARIO("Structs bound to options", "[Bind]")
+{
+    GIVEN("A struct with fields bound to options")
+    {
+        const int opt1 = INCFG_GET( opt1 );
+        const std::string opt3 = INCFG_GET( opt3 );
+        Settings settings;
+        REQUIRE( incfg::Binding< Settings >::instance().size() == 5 );
+
+        WHEN("It is refreshed for the first time")
+        {
+            REQUIRE( incfg::refresh( settings ) );
+
+            THEN("Every field should hold the value of its option")
+            {
+                REQUIRE( settings.threads == INCFG_GET( opt1 ) );
+                REQUIRE( settings.name == INCFG_GET( opt3 ) );
+                REQUIRE( settings.verbose == INCFG_GET( opt4 ) );
+                REQUIRE( settings.mode == INCFG_GET( opt16 ) );
+                REQUIRE( settings.frozen == 64 );
+                REQUIRE( settings.bound_version == incfg::ConfigOptions::instance().version() );
+            }
+            THEN("Refreshing again should do nothing until the configuration changes")
+            {
+                settings.threads = -1;
+                REQUIRE( !incfg::refresh( settings ) );
+                REQUIRE( settings.threads == -1 );
+
+                std::string config = "opt1 = 123\nopt3 = \"bound\"\n";
+                incfg::ConfigOptions::instance().load( config );
+                REQUIRE( incfg::refresh( settings ) );
+                REQUIRE( settings.threads == 123 );
+                REQUIRE( settings.name == "bound" );
+            }
+        }
+        WHEN("Its version is kept outside of the struct")
+        {
+            unsigned long long version = ~0ULL;
+            REQUIRE( incfg::refresh( settings, version ) );
+            REQUIRE( !incfg::refresh( settings, version ) );
+            REQUIRE( version == incfg::ConfigOptions::instance().version() );
+            REQUIRE( settings.bound_version == ~0ULL );
+        }
+
+        INCFG_SET( opt1, opt1 );
+        INCFG_SET( opt3, opt3 );
+    }
+}
+
+
+SCENARIO("Per-option versions", "[OptionVersion]")
+{
+    GIVEN("An option and its current version")
+    {
+        const int opt12 = INCFG_GET( opt12 );
+        const unsigned long long version = INCFG_VERSION( opt12 );
+        const unsigned long long other = INCFG_VERSION( opt13 );
+
+        WHEN("It is set to its current value")
+        {
+            INCFG_SET( opt12, opt12 );
+            std::string config = "opt12 = " + std::to_string( opt12 ) + "\n";
+            incfg::ConfigOptions::instance().load( config );
+
+            THEN("Its version should not change")
+            {
+                REQUIRE( INCFG_VERSION( opt12 ) == version );
+            }
+        }
+        WHEN("It is set to different values")
+        {
+            INCFG_SET( opt12, opt12+1 );
+            std::string config = "opt12 = " + std::to_string( opt12+2 ) + "\n";
+            incfg::ConfigOptions::instance().load( config );
+
+            THEN("Its version should be incremented once per change, and only its own")
+            {
+                REQUIRE( INCFG_VERSION( opt12 ) == version+2 );
+                REQUIRE( incfg::ConfigOptions::instance().get( "opt12" )->version() == version+2 );
+                REQUIRE( INCFG_VERSION( opt13 ) == other );
+            }
+            INCFG_SET( opt12, opt12 );
+        }
+        THEN("Frozen options should keep version 0")
+        {
+            REQUIRE( INCFG_VERSION( opt9 ) == 0 );
+        }
+    }
+}
+
+
+SCENARIO("Hardware-aware defaults", "[Hardware]")
+{
+    GIVEN("An option defaulting to the usable CPUs")
+    {
+        const incfg::Hardware& hw = incfg::hardware();
+
+        THEN("The configuration string should show the computed default")
+        {
+            REQUIRE( hw.online_cpus >= 1 );
+            REQUIRE( hw.page_size >= 1 );
+            REQUIRE( hw.cpus() >= 1 );
+            REQUIRE( INCFG_GET( opt18 ) == hw.cpus() );
+            REQUIRE( incfg::ConfigOptions::instance().to_config_string().find( "#opt18=" + std::to_string( hw.cpus() ) + "\n" ) != std::string::npos );
+        }
+    }
+
+#ifdef __linux__
+    GIVEN("cgroup and sysfs files under a fake root")
+    {
+        char root_template[] = "/tmp/incfg_hwXXXXXX";
+        const std::string root = mkdtemp( root_template );
+        const auto write = [&]( const std::string& path, const std::string& content )
+        {
+            for( size_t slash=path.find( '/', 1 ); slash!=std::string::npos; slash=path.find( '/', slash+1 ) )
+                mkdir( ( root + path.substr( 0, slash ) ).c_str(), 0700 );
+            std::ofstream( ( root + path ).c_str() ) << content;
+        };
+        write( "/sys/devices/system/cpu/cpu0/cache/index0/level", "1\n" );
+        write( "/sys/devices/system/cpu/cpu0/cache/index0/type", "Data\n" );
+        write( "/sys/devices/system/cpu/cpu0/cache/index0/size", "48K\n" );
+        write( "/sys/devices/system/cpu/cpu0/cache/index1/level", "2\n" );
+        write( "/sys/devices/system/cpu/cpu0/cache/index1/type", "Unified\n" );
+        write( "/sys/devices/system/cpu/cpu0/cache/index1/size", "2048K\n" );
+        write( "/sys/devices/system/cpu/cpu0/cache/index2/level", "3\n" );
+        write( "/sys/devices/system/cpu/cpu0/cache/index2/type", "Unified\n" );
+        write( "/sys/devices/system/cpu/cpu0/cache/index2/size", "32M\n" );
+
+        WHEN("The process is in a cgroup v2 hierarchy")
+        {
+            write( "/proc/self/cgroup", "0::/app/worker\n" );
+            write( "/sys/fs/cgroup/memory.max", "max\n" );
+            write( "/sys/fs/cgroup/app/cpu.max", "150000 100000\n" );
+            write( "/sys/fs/cgroup/app/worker/cpu.max", "max 100000\n" );
+            write( "/sys/fs/cgroup/app/worker/memory.max", "536870912\n" );
+            const incfg::Hardware probed = incfg::probe_hardware( root );
+
+            THEN("The tightest limits of the cgroup and its ancestors should apply")
+            {
+                REQUIRE( probed.cpu_quota == 1.5 );
+                REQUIRE( probed.cpus() == std::min( 2u, probed.available_cpus ) );
+                REQUIRE( probed.memory_limit == 536870912ULL );
+                REQUIRE( probed.usable_memory() == std::min( probed.memory, 536870912ULL ) );
+                REQUIRE( probed.l2_cache == 2048*1024ULL );
+                REQUIRE( probed.l3_cache == 32*1024*1024ULL );
+            }
+        }
+        WHEN("The process is in cgroup v1 hierarchies")
+        {
+            write( "/proc/self/cgroup", "4:memory:/job\n1:cpu,cpuacct:/job\n0::/\n" );
+            write( "/sys/fs/cgroup/cpu,cpuacct/cpu.cfs_quota_us", "300000\n" );
+            write( "/sys/fs/cgroup/cpu,cpuacct/cpu.cfs_period_us", "100000\n" );
+            write( "/sys/fs/cgroup/cpu,cpuacct/job/cpu.cfs_quota_us", "-1\n" );
+            write( "/sys/fs/cgroup/cpu,cpuacct/job/cpu.cfs_period_us", "100000\n" );
+            write( "/sys/fs/cgroup/memory/job/memory.limit_in_bytes", "9223372036854771712\n" );
+            const incfg::Hardware probed = incfg::probe_hardware( root );
+
+            THEN("Unlimited values should be ignored")
+            {
+                REQUIRE( probed.cpu_quota == 3 );
+                REQUIRE( probed.memory_limit == 0 );
+                REQUIRE( probed.usable_memory() == probed.memory );
+            }
+        }
+
+        REQUIRE( system( ( "rm -rf " + root ).c_str() ) == 0 );
+    }
+#endif
+}
+
+
+SCENARIO("Online auto-tuning", "[Tuner]")
+{
+    GIVEN("A bounded option and an objective peaking at 37")
+    {
+        const int opt12 = INCFG_GET( opt12 );
+        INCFG_SET( opt12, 10 );
+        const auto objective = []() { const double x = INCFG_GET( opt12 ); return -( x-37 )*( x-37 ); };
+
+        WHEN("The tuner is stepped with a linear policy")
+        {
+            incfg::Tuner< int > tuner( INCFG_OPTION( opt12 ), incfg::linear_policy( 0, 100, 8 ), objective, 16 );
+            for( int i=0; i<100; ++i )
+                REQUIRE( tuner.step() );
+
+            THEN("It should climb to the peak and keep probing its neighbours")
+            {
+                REQUIRE( tuner.best() == 37 );
+                REQUIRE( std::abs( INCFG_GET( opt12 ) - 37 ) <= 1 );
+
+                const std::vector< incfg::Tuner< int >::Decision > history = tuner.history();
+                REQUIRE( history.size() == 16 );
+                for( size_t i=1; i<history.size(); ++i )
+                {
+                    REQUIRE( history[i].value == history[i-1].next );
+                    REQUIRE( history[i].time >= history[i-1].time );
+                }
+            }
+        }
+        WHEN("The tuner is stepped with a geometric policy within bounds")
+        {
+            incfg::Tuner< int > tuner( INCFG_OPTION( opt12 ), incfg::geometric_policy( 1, 30, 2.0 ), objective );
+            for( int i=0; i<50; ++i )
+                tuner.step();
+
+            THEN("It should stop at the bound closest to the peak")
+            {
+                REQUIRE( tuner.best() == 30 );
+                const std::vector< incfg::Tuner< int >::Decision > history = tuner.history();
+                REQUIRE( history[0].action == incfg::TunerAction::baseline );
+                REQUIRE( history[1].action == incfg::TunerAction::accepted );
+                REQUIRE( history[1].value == 20 );
+            }
+        }
+        WHEN("The option is reloaded while the tuner probes a value")
+        {
+            incfg::Tuner< int > tuner( INCFG_OPTION( opt12 ), incfg::linear_policy( 0, 100, 8 ), objective );
+            REQUIRE( tuner.step() );
+            REQUIRE( INCFG_GET( opt12 ) == 18 );
+            INCFG_SET( opt12, 50 );
+            REQUIRE( tuner.step() );
+
+            THEN("The measurement should be discarded and the search restart from the new value")
+            {
+                const std::vector< incfg::Tuner< int >::Decision > history = tuner.history();
+                REQUIRE( history.back().action == incfg::TunerAction::restarted );
+                REQUIRE( history.back().value == 50 );
+                REQUIRE( tuner.best() == 50 );
+                REQUIRE( INCFG_GET( opt12 ) == 50 );
+
+                REQUIRE( tuner.step() );
+                REQUIRE( tuner.history().back().action == incfg::TunerAction::baseline );
+                REQUIRE( INCFG_GET( opt12 ) == 58 );
+            }
+        }
+        WHEN("A floating-point option at 0 is tuned with a geometric policy")
+        {
+            const double opt2 = INCFG_GET( opt2 );
+            INCFG_SET( opt2, 0.0 );
+            incfg::Tuner< double > tuner( INCFG_OPTION( opt2 ), incfg::geometric_policy( 0.0, 100.0, 2.0 ),
+                                          []() { return -std::fabs( INCFG_GET( opt2 ) - 8 ); } );
+            for( int i=0; i<20; ++i )
+                REQUIRE( tuner.step() );
+            const double best = tuner.best();
+            INCFG_SET( opt2, opt2 );
+
+            THEN("It should leave 0")
+            {
+                REQUIRE( best == 8.0 );
+            }
+        }
+        WHEN("The tuner runs in the background")
+        {
+            incfg::Tuner< int > tuner( INCFG_OPTION( opt12 ), incfg::linear_policy( 0, 100, 8 ), objective );
+            tuner.start( std::chrono::milliseconds( 1 ) );
+            for( int i=0; i<2000 && tuner.best() != 37; ++i )
+                std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+            tuner.stop();
+
+            THEN("It should find the peak through the option setter")
+            {
+                REQUIRE( tuner.best() == 37 );
+                REQUIRE( !tuner.is_stopped() );
+            }
+        }
+
+        INCFG_SET( opt12, opt12 );
+    }
+}
@@ -0,0 +1,261 @@
+/*
+ * Allocation and lock harness of the read paths (Linux/glibc only, built as incfgTEST_alloc)
+ *
+ * malloc/free and pthread_mutex_lock are interposed to count the calls made by the current thread
+ * while a probe runs (throwing allocates the exception, so it is counted as well). Every read API must
+ * make none under each storage mode: published values, NUMA replicas (emulated nodes) and a sealed
+ * configuration. The allocations made by load() and to_config_string() are printed as tracked
+ * metrics, one "metric <name> <value>" line each.
+ */
+
+#include "incfg.hpp"
+#include "incfg_units.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <mutex>
+#include <pthread.h>
+#include <sstream>
+
+extern "C" void* __libc_malloc( size_t size );
+extern "C" void* __libc_calloc( size_t count, size_t size );
+extern "C" void* __libc_realloc( void* ptr, size_t size );
+extern "C" void* __libc_memalign( size_t alignment, size_t size );
+extern "C" void __libc_free( void* ptr );
+
+
+namespace {
+
+struct Counts
+{
+    unsigned long allocations;
+    unsigned long frees;
+    unsigned long locks;
+};
+
+thread_local bool probing = false;
+thread_local Counts counts;
+
+}
+
+
+extern "C"
+{
+    void* malloc( size_t size ) noexcept
+    {
+        if( probing ) ++counts.allocations;
+        return __libc_malloc( size );
+    }
+
+    void* calloc( size_t count, size_t size ) noexcept
+    {
+        if( probing ) ++counts.allocations;
+        return __libc_calloc( count, size );
+    }
+
+    void* realloc( void* ptr, size_t size ) noexcept
+    {
+        if( probing ) ++counts.allocations;
+        return __libc_realloc( ptr, size );
+    }
+
+    void* aligned_alloc( size_t alignment, size_t size ) noexcept
+    {
+        if( probing ) ++counts.allocations;
+        return __libc_memalign( alignment, size );
+    }
+
+    void free( void* ptr ) noexcept
+    {
+        if( probing && ptr ) ++counts.frees;
+        __libc_free( ptr );
+    }
+
+    int pthread_mutex_lock( pthread_mutex_t* mutex ) noexcept
+    {
+        typedef int (*lock_function)( pthread_mutex_t* );
+        static const lock_function next = reinterpret_cast< lock_function >( dlsym( RTLD_NEXT, "pthread_mutex_lock" ) );
+        if( probing ) ++counts.locks;
+        return next( mutex );
+    }
+
+    int pthread_mutex_trylock( pthread_mutex_t* mutex ) noexcept
+    {
+        typedef int (*lock_function)( pthread_mutex_t* );
+        static const lock_function next = reinterpret_cast< lock_function >( dlsym( RTLD_NEXT, "pthread_mutex_trylock" ) );
+        if( probing ) ++counts.locks;
+        return next( mutex );
+    }
+}
+
+
+enum class AllocMode { Off, Fast, Safe };
+INCFG_ENUM( AllocMode, "off", "fast", "safe" )
+
+INCFG_REQUIRE( int, ALLOC_INT, 1, "int option" )
+INCFG_REQUIRE( double, ALLOC_DOUBLE, 2.5, "double option" )
+INCFG_REQUIRE( bool, ALLOC_FLAG, true, "bool option" )
+INCFG_REQUIRE( bool, ALLOC_FLAG2, false, "bool option" )
+INCFG_REQUIRE( std::string, ALLOC_STRING, "a string too long for the small string optimization", "string option" )
+INCFG_REQUIRE( AllocMode, ALLOC_MODE, AllocMode::Fast, "enum option" )
+INCFG_REQUIRE( std::chrono::milliseconds, ALLOC_DELAY, std::chrono::milliseconds( 5 ), "duration option" )
+INCFG_REQUIRE( incfg::ByteSize, ALLOC_SIZE, incfg::ByteSize( 4096 ), "byte size option" )
+
+struct AllocSettings : incfg::BoundStruct
+{
+    int num;
+    std::string str;
+    AllocMode mode;
+};
+INCFG_BIND( AllocSettings, num, ALLOC_INT )
+INCFG_BIND( AllocSettings, str, ALLOC_STRING )
+INCFG_BIND( AllocSettings, mode, ALLOC_MODE )
+
+
+namespace {
+
+volatile double sink = 0;
+int failures = 0;
+
+
+template <typename F>
+Counts probe( F f )
+{
+    counts = Counts();
+    probing = true;
+    f();
+    probing = false;
+    return counts;
+}
+
+
+// Runs a read once to warm it up (eg. the thread node lookup), then requires it to neither allocate nor lock
+template <typename F>
+void require_none( const char* mode, const char* name, F f )
+{
+    f();
+    const Counts c = probe( f );
+    if( c.allocations || c.frees || c.locks )
+    {
+        std::printf( "FAIL [%s] %s: %lu allocations, %lu frees, %lu locks\n", mode, name, c.allocations, c.frees, c.locks );
+        ++failures;
+    }
+}
+
+
+// Same as require_none for the getters copying a std::string value out: the copy may allocate (once), unless elided
+template <typename F>
+void require_copy( const char* mode, const char* name, F f )
+{
+    f();
+    const Counts c = probe( f );
+    if( c.allocations > 1 || c.frees != c.allocations || c.locks )
+    {
+        std::printf( "FAIL [%s] %s: %lu allocations, %lu frees, %lu locks\n", mode, name, c.allocations, c.frees, c.locks );
+        ++failures;
+    }
+}
+
+
+struct Variant
+{
+    template <bool FLAG, AllocMode MODE>
+    static int run( int x ) { return FLAG ? x + static_cast< int >( MODE ) : x; }
+};
+
+
+void check_reads( const char* mode )
+{
+    static auto variant = incfg::multiversion< Variant, int (*)( int ) >( INCFG_OPTION( ALLOC_FLAG ), INCFG_OPTION( ALLOC_MODE ) );
+    incfg::ConfigOptions& co = incfg::ConfigOptions::instance();
+
+    require_none( mode, "INCFG_GET int", []() { sink = sink + INCFG_GET( ALLOC_INT ); } );
+    require_none( mode, "INCFG_GET double", []() { sink = sink + INCFG_GET( ALLOC_DOUBLE ); } );
+    require_none( mode, "INCFG_GET bool", []() { sink = sink + INCFG_GET( ALLOC_FLAG ); } );
+    require_copy( mode, "INCFG_GET std::string", []() { sink = sink + INCFG_GET( ALLOC_STRING ).length(); } );
+    require_none( mode, "INCFG_GET enum", []() { sink = sink + static_cast< int >( INCFG_GET( ALLOC_MODE ) ); } );
+    require_none( mode, "INCFG_GET duration", []() { sink = sink + INCFG_GET( ALLOC_DELAY ).count(); } );
+    require_none( mode, "INCFG_GET ByteSize", []() { sink = sink + INCFG_GET( ALLOC_SIZE ).count(); } );
+    require_copy( mode, "TypedOption::get", []() { sink = sink + incfg_ALLOC_STRING_Option_instance.get().length(); } );
+    require_none( mode, "ConfigOptions::version", [&]() { sink = sink + co.version(); } );
+    require_none( mode, "INCFG_VERSION", []() { sink = sink + INCFG_VERSION( ALLOC_INT ); } );
+    require_none( mode, "get_consistent", []()
+    {
+        const incfg::ConfigOptions::ReadSection section;
+        auto [num, str, flag] = incfg::get_consistent( section, INCFG_OPTION( ALLOC_INT ), INCFG_OPTION( ALLOC_STRING ), INCFG_OPTION( ALLOC_FLAG ) );
+        sink = sink + num + str.length() + flag;
+    } );
+    require_none( mode, "flags", []()
+    {
+        const auto both = incfg::flags( INCFG_OPTION( ALLOC_FLAG ), INCFG_OPTION( ALLOC_FLAG2 ) );
+        sink = sink + both.any() + both.all();
+    } );
+    require_none( mode, "multiversion", [&]() { sink = sink + variant( 1 ); } );
+    require_none( mode, "enum_name", []() { sink = sink + incfg::enum_name( INCFG_GET( ALLOC_MODE ) )[0]; } );
+    require_none( mode, "refresh (unchanged)", []()
+    {
+        static AllocSettings settings;
+        sink = sink + incfg::refresh( settings ) + settings.num;
+    } );
+}
+
+
+std::string generate_config( size_t lines )
+{
+    std::stringstream ss;
+    for( size_t i=0; i<lines; ++i )
+    {
+        ss << "# comment " << i << "\n";
+        ss << "ALLOC_INT = " << i << "\n";
+        ss << "ALLOC_STRING = \"value " << i << "\"\n";
+        ss << "ALLOC_MODE = " << ( i % 2 ? "safe" : "fast" ) << "\n";
+    }
+    return ss.str();
+}
+
+}
+
+
+int main()
+{
+    incfg::ConfigOptions& co = incfg::ConfigOptions::instance();
+
+    // The interposition must work, or every check would pass vacuously
+    std::mutex mutex;
+    const Counts self = probe( [&]()
+    {
+        std::lock_guard< std::mutex > lock( mutex );
+        const std::string copy( INCFG_GET( ALLOC_STRING ) );
+        sink = sink + copy.length();
+    } );
+    if( self.allocations != 1 || self.frees != 1 || self.locks != 1 )
+    {
+        std::printf( "FAIL malloc/free or pthread_mutex_lock are not interposed\n" );
+        return 1;
+    }
+
+    // Tracked metrics: allocations of the loaders and serializers
+    std::string config = generate_config( 100 );
+    const Counts load = probe( [&]() { co.load( config ); } );
+    std::printf( "metric load_allocations_per_line %.2f\n", static_cast< double >( load.allocations ) / 400 );
+    std::printf( "metric load_locks_per_line %.2f\n", static_cast< double >( load.locks ) / 400 );
+
+    const Counts dump = probe( [&]() { sink = sink + co.to_config_string().length(); } );
+    std::printf( "metric to_config_string_allocations %lu\n", dump.allocations );
+
+    check_reads( "published" );
+
+    co.enable_numa_replicas( 2 );
+    if( co.numa_replicas() == 0 )
+    {
+        std::printf( "FAIL NUMA replicas could not be enabled\n" );
+        ++failures;
+    }
+    check_reads( "replicas" );
+
+    co.seal();
+    check_reads( "sealed" );
+
+    std::printf( "%s\n", failures ? "FAILED" : "OK: no allocation nor lock on the read paths" );
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,94 @@
+// Test of the embedded profile (See incfg_embedded.hpp), built with -fno-exceptions -fno-rtti
+
+#define INCFG_EMBEDDED
+#include "incfg.hpp"
+
+#if defined(__GLIBC__)
+extern "C" void* __libc_malloc( size_t size );
+
+// Heap allocations made once main() has started
+static bool booted = false;
+static unsigned long allocations = 0;
+
+extern "C" void* malloc( size_t size ) noexcept
+{
+    if( booted ) ++allocations;
+    return __libc_malloc( size );
+}
+#endif
+
+enum class Mode { Fast, Safe, Debug };
+INCFG_ENUM( Mode, "fast", "safe", "debug" )
+
+INCFG_REQUIRE( int, EMB_INT, 10, "int option" )
+INCFG_REQUIRE( double, EMB_DOUBLE, 0.5, "double option" )
+INCFG_REQUIRE( bool, EMB_FLAG, false, "bool option" )
+INCFG_REQUIRE( incfg::InlineString< 16 >, EMB_NAME, "default", "string option" )
+INCFG_REQUIRE( Mode, EMB_MODE, Mode::Safe, "enum option" )
+
+
+#define CHECK( COND ) if( !(COND) ) return __LINE__;
+
+
+static int run()
+{
+    incfg::ConfigOptions& co = incfg::ConfigOptions::instance();
+    CHECK( co.size() == 5 );
+    CHECK( INCFG_GET( EMB_INT ) == 10 && INCFG_GET( EMB_MODE ) == Mode::Safe );
+
+    const char config[] = "# comment\n EMB_INT = 42\nEMB_DOUBLE=2.25\nEMB_NAME = \"a \\\"b\\\"\"\nEMB_MODE = debug\n";
+    CHECK( co.load( config, sizeof(config)-1 ) );
+    CHECK( INCFG_GET( EMB_INT ) == 42 && INCFG_GET( EMB_DOUBLE ) == 2.25 && INCFG_GET( EMB_MODE ) == Mode::Debug );
+    CHECK( std::strcmp( INCFG_GET( EMB_NAME ).c_str(), "a \"b\"" ) == 0 );
+    CHECK( !co.get( "EMB_INT" )->is_default() && co.get( "EMB_FLAG" )->is_default() );
+
+    // Errors are returned with their line
+    const char invalid[] = "EMB_INT = 1\nEMB_INT = x\n";
+    incfg::Status status = co.load( invalid, sizeof(invalid)-1 );
+    CHECK( status.code == incfg::Errc::invalid_value && status.line == 2 && INCFG_GET( EMB_INT ) == 1 );
+    const char unknown[] = "NOPE = 1";
+    CHECK( co.load( unknown, sizeof(unknown)-1 ).code == incfg::Errc::unknown_key );
+    const char syntax[] = "EMB_INT 1";
+    CHECK( co.load( syntax, sizeof(syntax)-1 ).code == incfg::Errc::syntax_error );
+    const char too_long[] = "EMB_NAME = 0123456789abcdefghij";
+    CHECK( co.load( too_long, sizeof(too_long)-1 ).code == incfg::Errc::invalid_value );
+
+    // The incremental parser keeps partial lines in the caller buffer
+    char line[32];
+    incfg::Parser parser( co, line, sizeof(line) );
+    CHECK( parser.feed( "EMB_INT = 7\nEMB_FL", 18 ) );
+    CHECK( parser.feed( "AG = true\nEMB_MODE = fa", 23 ) );
+    CHECK( parser.feed( "st", 2 ) );
+    CHECK( parser.finish() && parser.lines() == 3 );
+    CHECK( INCFG_GET( EMB_INT ) == 7 && INCFG_GET( EMB_FLAG ) && INCFG_GET( EMB_MODE ) == Mode::Fast );
+    CHECK( parser.feed( "EMB_NAME = \"a line longer than the parser buffer\"\n", 51 ).code == incfg::Errc::line_too_long );
+
+    const char* argv[] = { "prog", "--EMB_INT", "3", "--EMB_FLAG", "--EMB_NAME", "argv" };
+    CHECK( co.load( 6, const_cast< char** >( argv ) ) );
+    CHECK( INCFG_GET( EMB_INT ) == 3 && std::strcmp( INCFG_GET( EMB_NAME ).c_str(), "argv" ) == 0 );
+    CHECK( co.load( 2, const_cast< char** >( argv ) ).code == incfg::Errc::missing_value );
+
+    INCFG_SET( EMB_DOUBLE, 1.5 );
+    char out[256];
+    const size_t len = co.to_config_string( out, sizeof(out) );
+    const char expected[] = "EMB_INT = 3\nEMB_DOUBLE = 1.5\nEMB_FLAG = true\nEMB_NAME = \"argv\"\nEMB_MODE = fast\n";
+    CHECK( len == sizeof(expected)-1 && std::memcmp( out, expected, len ) == 0 );
+    CHECK( co.to_config_string( out, 4 ) == len );
+    return 0;
+}
+
+
+int main()
+{
+#if defined(__GLIBC__)
+    booted = true;
+#endif
+    const int failed_line = run();
+    if( failed_line )
+        return failed_line;
+#if defined(__GLIBC__)
+    if( allocations )
+        return 1;
+#endif
+    return 0;
+}
@@ -0,0 +1,22 @@
+// Smoke test of the incfg C++20 module (built with -DINCFG_BUILD_MODULE=ON)
+
+import incfg;
+
+#include <string>
+
+inline incfg::Required< "MODULE_OPT", int > MODULE_OPT( 42, "option declared without macros" );
+
+
+int main()
+{
+    if( MODULE_OPT.get()!=42 || !MODULE_OPT.is_default() )
+        return 1;
+
+    std::string confstr( "MODULE_OPT=7\n" );
+    incfg::ConfigOptions::instance().load( confstr );
+
+    if( MODULE_OPT.get()!=7 )
+        return 1;
+
+    return incfg::ConfigOptions::instance().to_json()=="{\"MODULE_OPT\":7}" ? 0 : 1;
+}
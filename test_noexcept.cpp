@@ -0,0 +1,97 @@
+// Test of the exception-free build mode (built with -fno-exceptions, header-only): errors are values
+
+#include "incfg.hpp"
+#include "incfg_units.hpp"
+#include <cstdio>
+
+struct Point
+{
+    int x;
+    int y;
+    bool operator==( const Point& other ) const { return x==other.x && y==other.y; }
+};
+
+namespace incfg
+{
+    template < >
+    inline std::string to_string_helper< Point >( Point val )
+    {
+        return to_string_helper< int >( val.x ) + "," + to_string_helper< int >( val.y );
+    }
+
+    template < >
+    inline Expected< Point > parse_value< Point >( const std::string& str, const Point& mytype )
+    {
+        Point p;
+        if( std::sscanf( str.c_str(), "%d,%d", &p.x, &p.y ) != 2 )
+            return Unexpected("Unable to parse "+str+" to a point");
+        return p;
+    }
+}
+
+enum class Mode { Fast, Safe, Debug };
+INCFG_ENUM( Mode, "fast", "safe", "debug" )
+
+INCFG_REQUIRE( int, NX_INT, 10, "int option" )
+INCFG_REQUIRE( bool, NX_FLAG, false, "bool option" )
+INCFG_REQUIRE( std::string, NX_NAME, "default", "string option" )
+INCFG_REQUIRE( Mode, NX_MODE, Mode::Safe, "enum option" )
+INCFG_REQUIRE( std::chrono::milliseconds, NX_DELAY, std::chrono::milliseconds( 5 ), "duration option" )
+INCFG_REQUIRE( Point, NX_POINT, Point(), "custom option" )
+
+
+#define CHECK( COND ) if( !(COND) ) return __LINE__;
+
+
+static int run()
+{
+    incfg::ConfigOptions& co = incfg::ConfigOptions::instance();
+
+    // Conversions return expected-style results
+    CHECK( *incfg::parse_value< int >( "42", 0 ) == 42 );
+    CHECK( !incfg::parse_value< int >( "x", 0 ) && !incfg::parse_value< int >( "x", 0 ).error().empty() );
+    CHECK( !incfg::parse_value< bool >( "yes", false ) );
+    CHECK( *incfg::parse_value< Mode >( "debug", Mode() ) == Mode::Debug && !incfg::parse_value< Mode >( "Debug", Mode() ) );
+    CHECK( incfg::parse_value< std::chrono::milliseconds >( "2s", std::chrono::milliseconds() )->count() == 2000 );
+    CHECK( !incfg::parse_value< std::chrono::milliseconds >( "1us", std::chrono::milliseconds() ) );
+
+    const std::string config = "# comment\nNX_INT = 42\nNX_NAME = \"a b\"\nNX_MODE = debug\nNX_DELAY = 1s\nNX_POINT = 3,4\n";
+    CHECK( co.try_load( config ) );
+    CHECK( INCFG_GET( NX_INT ) == 42 && INCFG_GET( NX_NAME ) == "a b" && INCFG_GET( NX_MODE ) == Mode::Debug );
+    CHECK( INCFG_GET( NX_DELAY ).count() == 1000 && INCFG_GET( NX_POINT ) == ( Point{ 3, 4 } ) );
+
+    // Errors are returned with their line, and nothing is applied
+    incfg::Status status = co.try_load( std::string( "NX_INT = 1\nNX_INT = x\nNX_INT = 2\n" ) );
+    CHECK( status.code == incfg::Errc::invalid_value && status.line == 2 && INCFG_GET( NX_INT ) == 42 );
+    CHECK( std::string( status.message() ).find( "(Line 2)" ) != std::string::npos );
+    CHECK( co.try_load( std::string( "NX_POINT = 3;4" ) ).code == incfg::Errc::invalid_value );
+    CHECK( co.try_load( std::string( "\nNOPE = 1" ) ).code == incfg::Errc::unknown_key );
+    CHECK( co.try_load( std::string( "\n\nNX_INT 1" ) ).line == 3 );
+
+    incfg::Parser parser( co, 16 );
+    CHECK( parser.try_feed( "NX_INT = 7\nNX_FL", 16 ) && parser.try_feed( "AG = true", 9 ) && parser.try_finish() );
+    CHECK( INCFG_GET( NX_INT ) == 7 && INCFG_GET( NX_FLAG ) );
+    CHECK( parser.try_feed( "NX_NAME = \"longer than the limit\"\n", 34 ).code == incfg::Errc::line_too_long );
+
+    const char* argv[] = { "prog", "--NX_INT", "3", "--NX_FLAG", "--NX_MODE" };
+    CHECK( co.try_load( 4, const_cast< char** >( argv ) ) && INCFG_GET( NX_INT ) == 3 );
+    status = co.try_load( 5, const_cast< char** >( argv ) );
+    CHECK( status.code == incfg::Errc::missing_value && status.line == 4 );
+
+    // Setters report sealed options
+    co.seal( { "NX_INT" } );
+    CHECK( incfg_NX_INT_Option_instance.try_set( 5 ).code == incfg::Errc::sealed && INCFG_GET( NX_INT ) == 3 );
+    CHECK( co.try_load( std::string( "NX_INT = 4" ) ).code == incfg::Errc::sealed );
+    co.seal();
+    CHECK( co.try_load( std::string( "NX_NAME = sealed" ) ).code == incfg::Errc::sealed && INCFG_GET( NX_NAME ) == "a b" );
+    return 0;
+}
+
+
+int main()
+{
+    const int failed_line = run();
+    if( failed_line )
+        std::printf( "FAIL at line %d\n", failed_line );
+    return failed_line;
+}